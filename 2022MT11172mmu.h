@@ -1,553 +1,3472 @@
-#define _GNU_SOURCE
-#include <stdio.h>
-#include <stdint.h>
-#include <stdlib.h>
-#include <string.h>
-#include <sys/mman.h>
-#include <unistd.h>
-#include <errno.h>
-#include <assert.h>
-
-#ifndef ARENA_MIN
-#define ARENA_MIN (1u<<20)
-#endif
-#ifndef ALIGN
-#define ALIGN 16u
-#endif
-#ifndef BUDDY_MAX_ORDER
-#define BUDDY_MAX_ORDER 26
-#endif
-
-#define ALIGN_UP(x,a) (((x)+((a)-1)) & ~((a)-1))
-
-typedef struct Block Block;
-
-typedef struct {
-    Block *l, *r;
-    int8_t h;
-} AVL;
-
-typedef struct Block {
-    size_t size;
-    uint32_t is_free;
-    uint32_t _pad;
-    Block *prev_phys;
-    Block *next_phys;
-    Block *next_free;
-    AVL avl;
-} Block;
-
-typedef struct Arena {
-    struct Arena *next;
-    size_t size;
-} Arena;
-
-static Arena *g_arenas = NULL;
-#define HDR_SZ ALIGN_UP(sizeof(Block), ALIGN)
-
-static inline void *blk_to_ptr(Block *b){ return (void*)((uint8_t*)b + HDR_SZ); }
-static inline Block *ptr_to_blk(void *p){ return (Block*)((uint8_t*)p - HDR_SZ); }
-
-typedef enum {
-    STRAT_UNSET = -1,
-    STRAT_FIRST = 0,
-    STRAT_NEXT  = 1,
-    STRAT_BEST  = 2,
-    STRAT_WORST = 3
-} Strategy;
-
-static Strategy g_strat = STRAT_UNSET;
-static void index_insert(Block *b);
-static void index_remove(Block *b);
-static Block* index_find(size_t need);
-
-static Block *g_free_head = NULL;
-static Block *g_nextfit_cursor = NULL;
-static Block *g_avl_root = NULL;
-
-
-static Arena* map_arena(size_t min_usable){
-    size_t need = sizeof(Arena) + HDR_SZ + min_usable;
-    if (need < ARENA_MIN) need = ARENA_MIN;
-
-    void *mem = mmap(NULL, need, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
-    if (mem == MAP_FAILED) return NULL;
-
-    Arena *ar = (Arena*)mem;
-    ar->next = g_arenas;
-    ar->size = need;
-    g_arenas = ar;
-
-    Block *b = (Block*)((uint8_t*)ar + sizeof(Arena));
-    b->size = need - sizeof(Arena) - HDR_SZ;
-    b->is_free = 1;
-    b->_pad = 0;
-    b->prev_phys = NULL;
-    b->next_phys = NULL;
-    b->next_free = NULL;
-    b->avl.l = b->avl.r = NULL;
-    b->avl.h = 1;
-
-    index_insert(b);
-    return ar;
-}
-
-__attribute__((constructor))
-static void init_once(void){ (void)map_arena(ARENA_MIN); }
-
-static void fl_push_sorted(Block *b){
-    Block **pp = &g_free_head;
-    while (*pp && *pp < b) pp = &(*pp)->next_free;
-    b->next_free = *pp;
-    *pp = b;
-}
-
-static void fl_remove(Block *b){
-    Block **pp = &g_free_head;
-    while (*pp && *pp != b) pp = &(*pp)->next_free;
-    if (*pp) *pp = b->next_free;
-    if (g_nextfit_cursor == b)
-        g_nextfit_cursor = b->next_free ? b->next_free : g_free_head;
-    b->next_free = NULL;
-}
-
-static Block* fl_first_fit(size_t need){
-    Block *cur = g_free_head;
-    while (cur){
-        if (cur->size >= need) return cur;
-        cur = cur->next_free;
-    }
-    return NULL;
-}
-
-static Block* fl_next_fit(size_t need){
-    if (!g_nextfit_cursor) g_nextfit_cursor = g_free_head;
-    if (!g_nextfit_cursor) return NULL;
-
-    Block *start = g_nextfit_cursor, *cur = g_nextfit_cursor;
-    do {
-        if (cur->size >= need){
-            g_nextfit_cursor = cur->next_free ? cur->next_free : g_free_head;
-            return cur;
-        }
-        cur = cur->next_free ? cur->next_free : g_free_head;
-    } while(cur && cur != start);
-    return NULL;
-}
-
-static inline size_t key_size(Block *b){ return b->size; }
-static inline uintptr_t key_addr(Block *b){ return (uintptr_t)(void*)b; }
-
-static int cmp_block(Block *a, Block *b){
-    if (key_size(a) < key_size(b)) return -1;
-    if (key_size(a) > key_size(b)) return 1;
-    if (key_addr(a) < key_addr(b)) return -1;
-    if (key_addr(a) > key_addr(b)) return 1;
-    return 0;
-}
-
-static int8_t height(Block *n){ return n ? n->avl.h : 0; }
-
-static void upd(Block *n){
-    int8_t hl = height(n->avl.l), hr = height(n->avl.r);
-    n->avl.h = (hl > hr ? hl : hr) + 1;
-}
-
-static Block* rotR(Block *y){
-    Block *x = y->avl.l, *T2 = x->avl.r;
-    x->avl.r = y;
-    y->avl.l = T2;
-    upd(y);
-    upd(x);
-    return x;
-}
-
-static Block* rotL(Block *x){
-    Block *y = x->avl.r, *T2 = y->avl.l;
-    y->avl.l = x;
-    x->avl.r = T2;
-    upd(x);
-    upd(y);
-    return y;
-}
-
-static int balance_factor(Block *n){ return n ? height(n->avl.l) - height(n->avl.r) : 0; }
-
-static Block* avl_insert_rec(Block *root, Block *node){
-    if (!root) return node;
-    int c = cmp_block(node, root);
-    if (c < 0) root->avl.l = avl_insert_rec(root->avl.l, node);
-    else if (c > 0) root->avl.r = avl_insert_rec(root->avl.r, node);
-    else return root;
-    upd(root);
-    int bf = balance_factor(root);
-    if (bf > 1 && cmp_block(node, root->avl.l) < 0) return rotR(root);
-    if (bf < -1 && cmp_block(node, root->avl.r) > 0) return rotL(root);
-    if (bf > 1 && cmp_block(node, root->avl.l) > 0){
-        root->avl.l = rotL(root->avl.l);
-        return rotR(root);
-    }
-    if (bf < -1 && cmp_block(node, root->avl.r) < 0){
-        root->avl.r = rotR(root->avl.r);
-        return rotL(root);
-    }
-    return root;
-}
-
-static Block* avl_lower_bound(Block *root, size_t need){
-    Block *ans = NULL;
-    while (root){
-        if (need <= root->size){ ans = root; root = root->avl.l; }
-        else root = root->avl.r;
-    }
-    return ans;
-}
-
-// Find the rightmost (largest) block >= need in O(log n) time
-static Block* avl_rightmost_ge(Block *root, size_t need){
-    Block *ans = NULL;
-    while (root){
-        if (root->size >= need){
-            // This block fits; remember it as a candidate
-            ans = root;
-            // Keep searching right for larger blocks
-            root = root->avl.r;
-        }else{
-            // Block too small; go right (left would be even smaller)
-            root = root->avl.r;
-        }
-    }
-    return ans;
-}
-
-static Block* avl_min(Block *n){
-    while(n && n->avl.l) n = n->avl.l;
-    return n;
-}
-
-static Block* avl_delete_rec(Block *root, Block *node){
-    if (!root) return NULL;
-    int c = cmp_block(node, root);
-    if (c < 0){
-        root->avl.l = avl_delete_rec(root->avl.l, node);
-    } else if (c > 0){
-        root->avl.r = avl_delete_rec(root->avl.r, node);
-    } else {
-        if (!root->avl.l) return root->avl.r;
-        if (!root->avl.r) return root->avl.l;
-        Block *s = avl_min(root->avl.r);
-        root->avl.r = avl_delete_rec(root->avl.r, s);
-        s->avl.l = root->avl.l;
-        s->avl.r = root->avl.r;
-        root = s;
-    }
-    upd(root);
-    int bf = balance_factor(root);
-    if (bf > 1 && balance_factor(root->avl.l) >= 0) return rotR(root);
-    if (bf > 1 && balance_factor(root->avl.l) < 0){
-        root->avl.l = rotL(root->avl.l);
-        return rotR(root);
-    }
-    if (bf < -1 && balance_factor(root->avl.r) <= 0) return rotL(root);
-    if (bf < -1 && balance_factor(root->avl.r) > 0){
-        root->avl.r = rotR(root->avl.r);
-        return rotL(root);
-    }
-    return root;
-}
-
-static void avl_insert(Block *b){
-    b->avl.l = b->avl.r = NULL;
-    b->avl.h = 1;
-    g_avl_root = avl_insert_rec(g_avl_root, b);
-}
-
-static void avl_erase(Block *b){
-    g_avl_root = avl_delete_rec(g_avl_root, b);
-}
-
-// ======================= Index dispatch (strict independence) =======================
-
-static void ensure_arena(size_t need){
-    if (g_strat == STRAT_UNSET) return;
-    Block *probe = index_find(need);
-    if (!probe) (void)map_arena(need);
-}
-
-static void index_insert(Block *b){
-    if (g_strat == STRAT_FIRST || g_strat == STRAT_NEXT || g_strat == STRAT_UNSET){
-        fl_push_sorted(b);
-    } else {
-        avl_insert(b);
-    }
-}
-
-static void index_remove(Block *b){
-    if (g_strat == STRAT_FIRST || g_strat == STRAT_NEXT){
-        fl_remove(b);
-    } else if (g_strat == STRAT_BEST || g_strat == STRAT_WORST){
-        avl_erase(b);
-    } else {
-        fl_remove(b);
-    }
-}
-
-static Block* index_find(size_t need){
-    if (g_strat == STRAT_FIRST)  return fl_first_fit(need);
-    if (g_strat == STRAT_NEXT)   return fl_next_fit(need);
-    if (g_strat == STRAT_BEST)   return avl_lower_bound(g_avl_root, need);
-    if (g_strat == STRAT_WORST)  return avl_rightmost_ge(g_avl_root, need);
-    return fl_first_fit(need);
-}
-
-// ======================= Split & Coalesce (index-agnostic) =======================
-
-static Block* split_block(Block *b, size_t need){
-    size_t left = b->size - need;
-    size_t min_split = HDR_SZ + ALIGN_UP(1, ALIGN);
-    if (left < min_split) return b;
-
-    uint8_t *base = (uint8_t*)b;
-    Block *alloc = b;
-    Block *rem = (Block*)(base + HDR_SZ + need);
-
-    rem->size = left - HDR_SZ;
-    rem->is_free = 1; rem->_pad = 0;
-    rem->prev_phys = alloc;
-    rem->next_phys = alloc->next_phys;
-    if (rem->next_phys) rem->next_phys->prev_phys = rem;
-
-    rem->next_free = NULL;
-    rem->avl.l = rem->avl.r = NULL; rem->avl.h = 1;
-
-    alloc->size = need;
-    alloc->next_phys = rem;
-
-    index_insert(rem);
-    return alloc;
-}
-
-static void coalesce_and_insert(Block *b){
-    Block *L = b->prev_phys, *R = b->next_phys;
-
-    if (L && L->is_free){
-        index_remove(L);
-        L->size += HDR_SZ + b->size;
-        L->next_phys = b->next_phys;
-        if (b->next_phys) b->next_phys->prev_phys = L;
-        b = L;
-    }
-
-    if (R && R->is_free){
-        index_remove(R);
-        b->size += HDR_SZ + R->size;
-        b->next_phys = R->next_phys;
-        if (R->next_phys) R->next_phys->prev_phys = b;
-    }
-
-    b->next_free = NULL;
-    b->avl.l = b->avl.r = NULL;
-    b->avl.h = 1;
-
-    index_insert(b);
-}
-
-// ======================= Allocation core (general heap) =======================
-
-static Block* allocate_general(size_t size){
-    if (size == 0) return NULL;
-    size = ALIGN_UP(size, ALIGN);
-
-    Block *b = index_find(size);
-    if (!b){
-        if (!map_arena(size)) return NULL;
-        b = index_find(size);
-        if (!b) return NULL;
-    }
-
-    index_remove(b);
-    b = split_block(b, size);
-    b->is_free = 0;
-    return b;
-}
-
-// ======================= Public malloc flavors (lock-in strategy) =======================
-
-static int lock_strategy(Strategy s){
-    if (g_strat == STRAT_UNSET){ g_strat = s; return 1; }
-    if (g_strat != s){
-        fprintf(stderr, "[allocator] ERROR: mixed strategies in one run (%d vs %d)\n",(int)g_strat,(int)s);
-        abort();
-    }
-    return 1;
-}
-
-void allocator_init(Strategy s){ lock_strategy(s); }
-
-void* malloc_first_fit(size_t size){ lock_strategy(STRAT_FIRST); Block *b=allocate_general(size); return b? blk_to_ptr(b):NULL; }
-void* malloc_next_fit (size_t size){ lock_strategy(STRAT_NEXT ); Block *b=allocate_general(size); return b? blk_to_ptr(b):NULL; }
-void* malloc_best_fit (size_t size){ lock_strategy(STRAT_BEST ); Block *b=allocate_general(size); return b? blk_to_ptr(b):NULL; }
-void* malloc_worst_fit(size_t size){ lock_strategy(STRAT_WORST); Block *b=allocate_general(size); return b? blk_to_ptr(b):NULL; }
-
-static void free_general(void *ptr){
-    if (!ptr) return;
-    Block *b = ptr_to_blk(ptr);
-    if (b->is_free) return;
-    b->is_free = 1;
-    coalesce_and_insert(b);
-}
-
-// ======================= Buddy allocator (independent) =======================
-
-typedef struct BuddyNode { struct BuddyNode *next; } BuddyNode;
-static void *buddy_base=NULL; static size_t buddy_top_size=0;
-static size_t buddy_order0=0; static size_t buddy_pool_order=0;
-static BuddyNode *buddy_bins[BUDDY_MAX_ORDER+1];
-
-static inline size_t order_size(size_t o){ return (size_t)1<<o; }
-static inline size_t ptr_off(void *p){ return (size_t)((uint8_t*)p - (uint8_t*)buddy_base); }
-static inline void* off_ptr(size_t off){ return (void*)((uint8_t*)buddy_base + off); }
-
-static void buddy_push(size_t o, void *p){ BuddyNode *n=(BuddyNode*)p; n->next=buddy_bins[o]; buddy_bins[o]=n; }
-static void* buddy_pop(size_t o){ BuddyNode *n=buddy_bins[o]; if (!n) return NULL; buddy_bins[o]=n->next; return (void*)n; }
-
-static void buddy_init_pool(size_t min_bytes){
-    size_t min_block = ALIGN_UP(sizeof(BuddyNode)+sizeof(size_t), ALIGN);
-    buddy_order0 = 0; while (order_size(buddy_order0) < min_block) buddy_order0++;
-    
-    buddy_pool_order = 22;
-    if (min_bytes > (size_t)(1<<22)){
-        size_t need = ALIGN_UP(min_bytes + sizeof(size_t), order_size(buddy_order0));
-        buddy_pool_order = buddy_order0;
-        while (order_size(buddy_pool_order) < need && buddy_pool_order < BUDDY_MAX_ORDER) buddy_pool_order++;
-    }
-    
-    size_t total = order_size(buddy_pool_order);
-    void *mem = mmap(NULL,total,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
-    if (mem==MAP_FAILED){ buddy_base=NULL; buddy_top_size=0; return; }
-    buddy_base=mem; buddy_top_size=total;
-    for (size_t i=0;i<=BUDDY_MAX_ORDER;i++) buddy_bins[i]=NULL;
-    buddy_push(buddy_pool_order,buddy_base);
-}
-
-static void buddy_try_merge(size_t order, void *p){
-    if (!p || !buddy_base) return;
-    size_t off=ptr_off(p);
-    if (off>=buddy_top_size) return;
-
-    for (; order<buddy_pool_order; ++order){
-        size_t block_sz=order_size(order);
-        size_t buddy_off = off ^ block_sz;
-        if (buddy_off>=buddy_top_size) break;
-        void *buddy_ptr=off_ptr(buddy_off);
-
-        BuddyNode **pp=&buddy_bins[order], *prev=NULL, *cur=*pp;
-        int found=0;
-        while(cur){
-            if ((void*)cur==buddy_ptr){
-                if(prev) prev->next=cur->next; else *pp=cur->next;
-                found=1; break;
-            }
-            prev=cur; cur=cur->next;
-        }
-        if (found){
-            off = (buddy_off<off)?buddy_off:off;
-            continue;
-        } else {
-            buddy_push(order, off_ptr(off));
-            return;
-        }
-    }
-    buddy_push(order, off_ptr(off));
-}
-
-void* malloc_buddy_alloc(size_t size){
-    if (size==0) return NULL;
-    size=ALIGN_UP(size,ALIGN);
-    if (!buddy_base) buddy_init_pool(size);
-    if (!buddy_base) return NULL;
-
-    size_t need = size + sizeof(size_t);
-    size_t order=buddy_order0;
-    while (order_size(order) < need && order<=buddy_pool_order) order++;
-    if (order>buddy_pool_order) return NULL;
-
-    size_t k=order;
-    while (k<=buddy_pool_order && !buddy_bins[k]) k++;
-    if (k>buddy_pool_order) return NULL;
-
-    void *p=buddy_pop(k);
-    while (k>order){
-        k--;
-        size_t half=order_size(k);
-        void *right=(void*)((uint8_t*)p+half);
-        buddy_push(k,right);
-    }
-
-    size_t *hdr=(size_t*)p;
-    *hdr = (size_t)0x8000000000000000ull | order;
-    void *user=(void*)(hdr+1);
-    return user;
-}
-
-static int is_buddy_ptr(void *ptr, size_t *out_order, void **out_raw){
-    if (!buddy_base) return 0;
-    uintptr_t a=(uintptr_t)ptr;
-    uintptr_t L=(uintptr_t)buddy_base;
-    uintptr_t R=L+buddy_top_size;
-    if (a<=L || a>=R) return 0;
-    size_t *hdr=(size_t*)ptr - 1;
-    size_t tag=*hdr;
-    if ((tag & 0x8000000000000000ull)==0) return 0;
-    size_t order = tag & 0x7fffffffffffffffull;
-    if (order>buddy_pool_order) return 0;
-    if (out_order) *out_order=order;
-    if (out_raw) *out_raw=(void*)hdr;
-    return 1;
-}
-
-// ======================= Unified free =======================
-
-void my_free(void *ptr){
-    if (!ptr) return;
-    size_t ord; void *raw;
-    if (is_buddy_ptr(ptr, &ord, &raw)){ buddy_try_merge(ord, raw); return; }
-    free_general(ptr);
-}
-
-#ifdef TEST_ALLOCATOR
-static void dump_free_list(void){
-    fprintf(stderr,"[free_list]");
-    Block *c=g_free_head; while(c){ fprintf(stderr," ->(%zu)",c->size); c=c->next_free; }
-    fprintf(stderr,"\n");
-}
-static int avl_height(Block *n){ return n? 1 + (avl_height(n->avl.l)>avl_height(n->avl.r)?avl_height(n->avl.l):avl_height(n->avl.r)) : 0; }
-
-int main(void){
-    allocator_init(STRAT_FIRST);
-
-    void *a = malloc_first_fit(1000);
-    void *b = malloc_first_fit(2000);
-    void *c = malloc_first_fit(3000);
-    fprintf(stderr,"alloc a=%p b=%p c=%p\n",a,b,c);
-
-    my_free(b);
-    my_free(a);
-    my_free(c);
-
-    void *e = malloc_buddy_alloc(1024);
-    void *f = malloc_buddy_alloc(4096);
-    fprintf(stderr,"buddy e=%p f=%p\n", e,f);
-    my_free(e); my_free(f);
-
-    for (size_t s=1;s<=64;++s){
-        void *p = malloc_first_fit(s);
-        assert(((uintptr_t)p % ALIGN)==0);
-        my_free(p);
-    }
-
-    if (g_strat==STRAT_FIRST || g_strat==STRAT_NEXT) dump_free_list();
-    if (g_strat==STRAT_BEST || g_strat==STRAT_WORST) fprintf(stderr,"[avl height] %d\n", avl_height(g_avl_root));
-    return 0;
-}
-#endif
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <sched.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MMU_KERN_X86 1
+#endif
+
+#ifndef ARENA_MIN
+#define ARENA_MIN (1u<<20)
+#endif
+#ifndef ARENA_MAX
+#define ARENA_MAX (4u<<20)
+#endif
+// Define MMU_NUMA to have init_once call mmu_numa_init().
+// Define MMU_RESERVE_BYTES to have init_once call mmu_reserve() with it
+// (and MMU_RESERVE_PREFAULT) instead of mapping a first arena on its own.
+#ifndef MMU_RESERVE_PREFAULT
+#define MMU_RESERVE_PREFAULT 0
+#endif
+#ifndef ALIGN
+#define ALIGN 16u
+#endif
+#ifndef FL_SEGS
+#define FL_SEGS 128         // first-fit summary segments per arena (power of two)
+#endif
+#ifndef BUDDY_MAX_ORDER
+#define BUDDY_MAX_ORDER 26
+#endif
+#ifndef BUDDY_PAGE_ORDER
+#define BUDDY_PAGE_ORDER 12
+#endif
+#ifndef POOL_SLAB_SIZE
+#define POOL_SLAB_SIZE (64u<<10)
+#endif
+#ifndef CACHE_LINE
+#define CACHE_LINE 64u
+#endif
+#ifndef QUICK_BINS
+#define QUICK_BINS 64
+#endif
+#ifndef QUICK_LIMIT
+#define QUICK_LIMIT 4096
+#endif
+
+#define ALIGN_UP(x,a) (((x)+((a)-1)) & ~((a)-1))
+
+typedef struct Block Block;
+
+typedef struct {
+    Block *l, *r;
+    int8_t h;
+} AVL;
+
+// Boundary-tag header: only prev_size and head live in front of every block.
+// The index links overlay the first payload bytes and are valid only while
+// the block is free (a block sits in exactly one index at a time).
+typedef struct Block {
+    size_t prev_size;          // payload size of the physical predecessor, 0 if first in arena
+    size_t head;               // payload size | BLK_* flags
+    union {
+        struct { Block *next_free, *prev_free; };
+        AVL avl;
+    };
+} Block;
+
+typedef struct Arena {
+    struct Arena *next;
+    size_t size;
+    struct Arena *node_next;    // next arena of the same NUMA node
+    uint32_t node;              // NUMA node the arena belongs to, 0 without NUMA
+    // First/next-fit summary of this arena's free blocks, which sit
+    // contiguously in the address-ordered free list: the run's ends and a
+    // count per size class (floor(log2(size))). Unused by other owners.
+    Block *fl_first, *fl_last;
+    uint64_t fl_mask;
+    uint32_t fl_count[64];
+    // The arena is also cut into FL_SEGS segments of 2^fl_seg_shift bytes,
+    // each with the offset (in ALIGN units, 0 = none) of its first free
+    // block and an upper bound on its free blocks' size classes.
+    uint32_t fl_seg_first[FL_SEGS];
+    uint8_t fl_seg_max[FL_SEGS];
+    uint8_t fl_seg_shift;
+} Arena;
+
+static Arena *g_arenas = NULL;
+#define HDR_SZ ALIGN_UP(offsetof(Block, next_free), ALIGN)
+#define MIN_PAYLOAD ALIGN_UP(sizeof(Block) - offsetof(Block, next_free), ALIGN)
+#define ARENA_HDR_SZ ALIGN_UP(sizeof(Arena), ALIGN)
+
+#define BLK_FREE  ((size_t)1)
+#define BLK_LAST  ((size_t)2)
+#define BLK_QUICK ((size_t)4)       // parked on a quick-list (lazy coalescing)
+#define BLK_FLAGS ((size_t)(ALIGN-1))
+
+static inline void *blk_to_ptr(Block *b){ return (void*)((uint8_t*)b + HDR_SZ); }
+static inline Block *ptr_to_blk(void *p){ return (Block*)((uint8_t*)p - HDR_SZ); }
+
+static inline size_t blk_size(Block *b){ return b->head & ~BLK_FLAGS; }
+static inline int blk_is_free(Block *b){ return (b->head & BLK_FREE) != 0; }
+static inline int blk_is_last(Block *b){ return (b->head & BLK_LAST) != 0; }
+static inline void blk_set_size(Block *b, size_t sz){ b->head = sz | (b->head & BLK_FLAGS); }
+
+static inline Block *blk_next_phys(Block *b){
+    return blk_is_last(b) ? NULL : (Block*)((uint8_t*)b + HDR_SZ + blk_size(b));
+}
+static inline Block *blk_prev_phys(Block *b){
+    return b->prev_size ? (Block*)((uint8_t*)b - HDR_SZ - b->prev_size) : NULL;
+}
+// Refresh the successor's boundary tag after b changed size.
+static inline void blk_sync_next(Block *b){
+    Block *n = blk_next_phys(b);
+    if (n) n->prev_size = blk_size(b);
+}
+
+typedef enum {
+    STRAT_UNSET = -1,
+    STRAT_FIRST = 0,
+    STRAT_NEXT  = 1,
+    STRAT_BEST  = 2,
+    STRAT_WORST = 3,
+    STRAT_AUTO  = 4     // adaptive: switches between the list and the tree
+} Strategy;
+
+static Strategy g_strat = STRAT_UNSET;      // index in use (never STRAT_AUTO)
+static int g_auto = 0;                      // STRAT_AUTO is locked
+static Strategy g_migrating = STRAT_UNSET;  // index still being emptied into g_strat's
+static size_t g_free_blocks = 0, g_free_bytes = 0;  // totals over the index
+static uint64_t g_fl_steps = 0;             // list nodes walked by lookups and inserts
+static void index_insert(Block *b);
+static void index_remove(Block *b);
+static Block* index_find(size_t need);
+
+static Block *g_free_head = NULL;
+static Block *g_nextfit_cursor = NULL;
+static Block *g_avl_root = NULL;
+static Block *g_compact_cursor = NULL;  // next block the incremental compactor visits
+static Block *g_migrate_cursor = NULL;  // next block STRAT_AUTO's index migration visits
+
+static inline void cursor_absorbed(Block **c, Block *b){
+    if (*c > b && (uint8_t*)*c < (uint8_t*)blk_to_ptr(b) + blk_size(b)) *c = b;
+}
+
+// A merge that swallows a walker's cursor block moves the cursor back to the
+// surviving block, so a paused walk never resumes on a dead header.
+static inline void blk_absorbed(Block *b){
+    cursor_absorbed(&g_compact_cursor, b);
+    cursor_absorbed(&g_migrate_cursor, b);
+}
+
+// ======================= Scan kernels (CPUID dispatch) =======================
+// The first-fit segment skip's search over packed bytes, in a scalar version
+// and SSE4.2 and AVX2 versions built through target attributes, so no -m
+// flags are needed. At startup the widest version the CPU supports is
+// installed (CPUID via __builtin_cpu_supports); mmu_kern_select() forces one
+// by name.
+//
+//   kern_find_ge(a, n, v)      first i with a[i] >= v, or n; entries and v
+//                              must be below 128 (they are size classes)
+
+typedef size_t (*KernGeFn)(const uint8_t *a, size_t n, unsigned v);
+
+// Eight bytes per word: adding 0x80 - v sets a byte's top bit exactly when
+// it is >= v, and bytes below 128 never carry into their neighbour.
+static size_t kern_find_ge_scalar(const uint8_t *a, size_t n, unsigned v){
+    const uint64_t ones = 0x0101010101010101ull;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8){
+        uint64_t w;
+        memcpy(&w, a + i, sizeof(w));
+        if ((w + ones * (0x80 - v)) & (ones << 7)) break;
+    }
+    for (; i < n; i++) if (a[i] >= v) return i;
+    return n;
+}
+
+#ifdef MMU_KERN_X86
+// Signed byte compares are exact for entries below 128; v = 0 compares
+// against -1 and matches everything.
+__attribute__((target("sse4.2")))
+static size_t kern_find_ge_sse42(const uint8_t *a, size_t n, unsigned v){
+    __m128i t = _mm_set1_epi8((char)(v - 1));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16){
+        int m = _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_loadu_si128((const __m128i*)(a + i)), t));
+        if (m) return i + (size_t)__builtin_ctz((unsigned)m);
+    }
+    for (; i < n; i++) if (a[i] >= v) return i;
+    return n;
+}
+
+__attribute__((target("avx2")))
+static size_t kern_find_ge_avx2(const uint8_t *a, size_t n, unsigned v){
+    __m256i t = _mm256_set1_epi8((char)(v - 1));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32){
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), t));
+        if (m) return i + (size_t)__builtin_ctz(m);
+    }
+    for (; i < n; i++) if (a[i] >= v) return i;
+    return n;
+}
+#endif
+
+static KernGeFn kern_find_ge = kern_find_ge_scalar;
+static const char *kern_isa = "scalar";
+
+// Install the kernel for isa ("scalar", "sse4.2", "avx2"; NULL = the
+// widest supported). Returns 0, changing nothing, if the CPU lacks it.
+int mmu_kern_select(const char *isa){
+#ifdef MMU_KERN_X86
+    __builtin_cpu_init();
+    int avx2 = __builtin_cpu_supports("avx2"), sse42 = __builtin_cpu_supports("sse4.2");
+    if (!isa) isa = avx2 ? "avx2" : sse42 ? "sse4.2" : "scalar";
+    if (!strcmp(isa, "avx2") && avx2){
+        kern_find_ge = kern_find_ge_avx2; kern_isa = "avx2";
+        return 1;
+    }
+    if (!strcmp(isa, "sse4.2") && sse42){
+        kern_find_ge = kern_find_ge_sse42; kern_isa = "sse4.2";
+        return 1;
+    }
+#endif
+    if (isa && strcmp(isa, "scalar")) return 0;
+    kern_find_ge = kern_find_ge_scalar; kern_isa = "scalar";
+    return 1;
+}
+
+const char* mmu_kern_name(void){ return kern_isa; }
+
+__attribute__((constructor))
+static void kern_init(void){ mmu_kern_select(NULL); }
+
+// ======================= Instrumentation (MMU_INSTRUMENT) =======================
+// Built with -DMMU_INSTRUMENT, every public entry point and the internal
+// phases below record their latency in ticks (rdtsc on x86, nanoseconds
+// elsewhere) into a log-linear histogram with 16 sub-buckets per power of
+// two (HDR-style, about 6% resolution), and fire a USDT probe mmu:<name>
+// with (argument, ticks) for perf and bpftrace. Without it MMU_TIME_BEGIN
+// and MMU_TIME_END expand to nothing, and the dump API only reports that.
+// Probes nest: malloc includes its index_find, split and arena_map.
+
+#define MMU_PROBES(X)                                                         \
+    X(malloc) X(free) X(free_sized) X(realloc) X(buddy_alloc)                 \
+    X(pool_alloc) X(pool_free) X(region_alloc) X(handle_alloc) X(compact)     \
+    X(index_find) X(index_remove) X(split) X(coalesce) X(arena_map)           \
+    X(buddy_split) X(buddy_merge)
+
+#define MMU_PROBE_ID(name) MMU_P_##name,
+typedef enum { MMU_PROBES(MMU_PROBE_ID) MMU_NPROBES } MmuProbe;
+
+#ifdef MMU_INSTRUMENT
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define MMU_SDT(name, a, t) DTRACE_PROBE2(mmu, name, a, t)
+#endif
+#endif
+#if !defined(MMU_SDT) && (defined(__x86_64__) || defined(__aarch64__)) && defined(__ELF__)
+// The .note.stapsdt entry <sys/sdt.h> would emit: a nop at the probe site
+// and a note naming provider, probe and argument locations.
+#define MMU_SDT(name, a, t)                                                   \
+    __asm__ __volatile__("990: nop\n"                                         \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n"                        \
+        ".balign 4\n"                                                         \
+        ".4byte 992f-991f, 994f-993f, 3\n"                                    \
+        "991: .asciz \"stapsdt\"\n"                                           \
+        "992: .balign 4\n"                                                    \
+        "993: .8byte 990b\n"                                                  \
+        ".8byte _.stapsdt.base\n"                                             \
+        ".8byte 0\n"                                                          \
+        ".asciz \"mmu\"\n"                                                    \
+        ".asciz \"" #name "\"\n"                                              \
+        ".asciz \"-8@%0 -8@%1\"\n"                                            \
+        "994: .balign 4\n"                                                    \
+        ".popsection\n"                                                       \
+        ".ifndef _.stapsdt.base\n"                                            \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+        ".weak _.stapsdt.base\n"                                              \
+        ".hidden _.stapsdt.base\n"                                            \
+        "_.stapsdt.base: .space 1\n"                                          \
+        ".size _.stapsdt.base, 1\n"                                           \
+        ".popsection\n"                                                       \
+        ".endif\n"                                                            \
+        :: "nor"((uint64_t)(a)), "nor"((uint64_t)(t)))
+#endif
+#ifndef MMU_SDT
+#define MMU_SDT(name, a, t) ((void)0)
+#endif
+
+#define HIST_SUB_BITS 4u
+#define HIST_SUB (1u << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64u - HIST_SUB_BITS + 1u) * HIST_SUB)
+
+typedef struct {
+    uint64_t bucket[HIST_BUCKETS];
+    uint64_t sum, max;
+} MmuHist;
+
+static MmuHist g_hist[MMU_NPROBES];
+
+#define MMU_PROBE_NAME(name) #name,
+static const char *const mmu_probe_names[] = { MMU_PROBES(MMU_PROBE_NAME) };
+
+static inline uint64_t mmu_ticks(void){
+#ifdef MMU_KERN_X86
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Values below HIST_SUB have a bucket each; above, bucket = (exponent, top
+// HIST_SUB_BITS bits below the leading one).
+static inline unsigned hist_bucket(uint64_t v){
+    if (v < HIST_SUB) return (unsigned)v;
+    unsigned e = 63u - (unsigned)__builtin_clzll(v);
+    return (e - HIST_SUB_BITS + 1u) * HIST_SUB + (unsigned)((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+static inline uint64_t hist_lower(unsigned i){
+    if (i < HIST_SUB) return i;
+    unsigned e = i / HIST_SUB + HIST_SUB_BITS - 1u;
+    return ((uint64_t)HIST_SUB + i % HIST_SUB) << (e - HIST_SUB_BITS);
+}
+
+// Relaxed atomics: buddy entry points run on many threads.
+static inline void mmu_record(MmuProbe p, uint64_t t){
+    MmuHist *h = &g_hist[p];
+    __atomic_fetch_add(&h->bucket[hist_bucket(t)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, t, __ATOMIC_RELAXED);
+    uint64_t m = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (t > m && !__atomic_compare_exchange_n(&h->max, &m, t, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+#define MMU_TIME_BEGIN(t) uint64_t t = mmu_ticks()
+#define MMU_TIME_END(name, t, arg) do {                                       \
+        uint64_t mmu_dt_ = mmu_ticks() - (t);                                 \
+        mmu_record(MMU_P_##name, mmu_dt_);                                    \
+        MMU_SDT(name, arg, mmu_dt_);                                          \
+    } while (0)
+
+uint64_t mmu_stats_count(MmuProbe p){
+    uint64_t n = 0;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) n += __atomic_load_n(&g_hist[p].bucket[i], __ATOMIC_RELAXED);
+    return n;
+}
+
+// Upper bound, in ticks, of the bucket holding quantile q (0..1); 0 if empty.
+uint64_t mmu_stats_percentile(MmuProbe p, double q){
+    uint64_t n = mmu_stats_count(p), seen = 0;
+    if (!n) return 0;
+    uint64_t rank = (uint64_t)(q * (double)(n - 1)) + 1;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++){
+        seen += __atomic_load_n(&g_hist[p].bucket[i], __ATOMIC_RELAXED);
+        if (seen >= rank){
+            uint64_t hi = i + 1 < HIST_BUCKETS ? hist_lower(i + 1) - 1 : UINT64_MAX;
+            uint64_t max = __atomic_load_n(&g_hist[p].max, __ATOMIC_RELAXED);
+            return hi < max ? hi : max;
+        }
+    }
+    return g_hist[p].max;
+}
+
+void mmu_stats_reset(void){ memset(g_hist, 0, sizeof(g_hist)); }
+
+// Ticks per nanosecond, measured once against CLOCK_MONOTONIC over ~10ms.
+static double mmu_tick_rate(void){
+#ifdef MMU_KERN_X86
+    static double rate = 0;
+    if (rate == 0){
+        struct timespec a, b, d = {0, 10000000};
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        uint64_t t0 = mmu_ticks();
+        nanosleep(&d, NULL);
+        uint64_t t1 = mmu_ticks();
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        rate = (double)(t1 - t0) / ((double)(b.tv_sec - a.tv_sec) * 1e9 + (double)(b.tv_nsec - a.tv_nsec));
+    }
+    return rate;
+#else
+    return 1.0;
+#endif
+}
+
+// One line per probe that fired: count, mean and percentiles in ticks.
+void mmu_stats_dump(FILE *out){
+    fprintf(out, "[mmu stats] ticks: %s, %.2f per ns\n",
+#ifdef MMU_KERN_X86
+            "rdtsc",
+#else
+            "ns",
+#endif
+            mmu_tick_rate());
+    fprintf(out, "%-13s %10s %9s %9s %9s %9s %9s %11s\n", "probe", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    for (int p = 0; p < MMU_NPROBES; p++){
+        uint64_t n = mmu_stats_count((MmuProbe)p);
+        if (!n) continue;
+        fprintf(out, "%-13s %10llu %9.1f %9llu %9llu %9llu %9llu %11llu\n", mmu_probe_names[p],
+                (unsigned long long)n, (double)g_hist[p].sum / (double)n,
+                (unsigned long long)mmu_stats_percentile((MmuProbe)p, 0.50),
+                (unsigned long long)mmu_stats_percentile((MmuProbe)p, 0.90),
+                (unsigned long long)mmu_stats_percentile((MmuProbe)p, 0.99),
+                (unsigned long long)mmu_stats_percentile((MmuProbe)p, 0.999),
+                (unsigned long long)g_hist[p].max);
+    }
+}
+
+#else
+
+#define MMU_TIME_BEGIN(t)
+#define MMU_TIME_END(name, t, arg) ((void)0)
+
+uint64_t mmu_stats_count(MmuProbe p){ (void)p; return 0; }
+uint64_t mmu_stats_percentile(MmuProbe p, double q){ (void)p; (void)q; return 0; }
+void mmu_stats_reset(void){}
+void mmu_stats_dump(FILE *out){ fprintf(out, "[mmu stats] built without MMU_INSTRUMENT\n"); }
+
+#endif
+
+// ======================= Page map (address -> owner) =======================
+// Three-level radix tree over the 4KB pages of a 48-bit address space, like
+// tcmalloc's pagemap. A leaf entry is the owner descriptor pointer with the
+// owner kind in its low bits, so my_free, my_usable_size and my_realloc
+// dispatch in three dependent loads however many heaps are mapped.
+
+#define PM_PAGE_SHIFT 12
+#define PM_BITS 12
+#define PM_LEN ((uintptr_t)1 << PM_BITS)
+#define PM_MASK (PM_LEN - 1)
+
+typedef enum {
+    OWN_NONE   = 0,
+    OWN_ARENA  = 1,     // general-heap arena; descriptor is the Arena
+    OWN_BUDDY  = 2,     // buddy pool; descriptor is buddy_base
+    OWN_POOL   = 3,     // object-pool slab; descriptor is the PoolSlab
+    OWN_REGION = 4,     // region chunk; descriptor is the MmuRegion
+    OWN_PHEAP  = 5      // file-backed heap; descriptor is the MmuPHeap header
+} OwnerKind;
+#define OWN_KIND_MASK ((uintptr_t)7)
+
+static uintptr_t **g_pagemap[PM_LEN];
+
+static inline OwnerKind pm_kind(uintptr_t e){ return (OwnerKind)(e & OWN_KIND_MASK); }
+static inline void* pm_owner(uintptr_t e){ return (void*)(e & ~OWN_KIND_MASK); }
+
+static inline uintptr_t pagemap_get(const void *p){
+    uintptr_t pg = (uintptr_t)p >> PM_PAGE_SHIFT;
+    if (pg >> (3*PM_BITS)) return 0;
+    uintptr_t **mid = g_pagemap[pg >> (2*PM_BITS)];
+    if (!mid) return 0;
+    uintptr_t *leaf = mid[(pg >> PM_BITS) & PM_MASK];
+    return leaf ? leaf[pg & PM_MASK] : 0;
+}
+
+static void* pm_node(void){
+    void *n = mmap(NULL, PM_LEN*sizeof(void*), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    return n == MAP_FAILED ? NULL : n;
+}
+
+// Point every page of [start, start+len) at owner (OWN_NONE clears). Interior
+// nodes are never freed; a cleared range only zeroes its leaf entries.
+static int pagemap_set(const void *start, size_t len, OwnerKind kind, const void *owner){
+    uintptr_t e = kind == OWN_NONE ? 0 : ((uintptr_t)owner | (uintptr_t)kind);
+    uintptr_t first = (uintptr_t)start >> PM_PAGE_SHIFT;
+    uintptr_t last = ((uintptr_t)start + len - 1) >> PM_PAGE_SHIFT;
+    if (len == 0 || (last >> (3*PM_BITS))) return 0;
+    for (uintptr_t pg = first; pg <= last; pg++){
+        uintptr_t ***mid = &g_pagemap[pg >> (2*PM_BITS)];
+        if (!*mid){
+            if (!e) continue;
+            if (!(*mid = (uintptr_t**)pm_node())) return 0;
+        }
+        uintptr_t **leaf = &(*mid)[(pg >> PM_BITS) & PM_MASK];
+        if (!*leaf){
+            if (!e) continue;
+            if (!(*leaf = (uintptr_t*)pm_node())) return 0;
+        }
+        (*leaf)[pg & PM_MASK] = e;
+    }
+    return 1;
+}
+
+// Map a raw chunk with an Arena header; the caller decides which list owns it.
+static Arena* map_arena_raw(size_t bytes){
+    bytes = ALIGN_UP(bytes, ALIGN);
+    void *mem = mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return NULL;
+
+    Arena *ar = (Arena*)mem;
+    ar->next = NULL;
+    ar->size = bytes;
+    return ar;
+}
+
+// ======================= Reservation (mmu_reserve) =======================
+// mmu_reserve() maps one PROT_NONE range up front and the general heap then
+// commits its arenas from it back to back, each with one mprotect, instead
+// of one mmap each at arbitrary addresses. Any pointer inside the committed
+// part is a general-heap block, by a single compare, unless compaction has
+// released an arena below the top. Such holes are kept in a small table and
+// reused first; while one exists pointers take the page-map walk. With
+// prefault the range is mapped read-write and populated at reserve time, so
+// later growth takes no page faults at all. Once it runs out, arenas come
+// from mmap again.
+#ifndef RSV_HOLES
+#define RSV_HOLES 16
+#endif
+
+static uint8_t *g_rsv_base = NULL, *g_rsv_top = NULL, *g_rsv_end = NULL;
+static int g_rsv_prefault = 0;
+static struct { uint8_t *lo, *hi; } g_rsv_hole[RSV_HOLES];  // released ranges below top
+static unsigned g_rsv_nholes = 0;
+static int g_rsv_lost = 0;          // a hole the table had no room for
+
+static inline int rsv_contains(const void *p){
+    return (uintptr_t)p - (uintptr_t)g_rsv_base < (uintptr_t)(g_rsv_top - g_rsv_base);
+}
+
+// pagemap_get for the free/realloc paths; reserved arenas skip the walk
+// (their entries carry no owner those paths need) while [base, top) has no
+// holes.
+static inline uintptr_t owner_of(const void *p){
+    return rsv_contains(p) && !(g_rsv_nholes | g_rsv_lost) ? (uintptr_t)OWN_ARENA : pagemap_get(p);
+}
+
+static void rsv_hole_drop(unsigned i){ g_rsv_hole[i] = g_rsv_hole[--g_rsv_nholes]; }
+
+// Record a released range below top, merged with the holes it touches.
+static void rsv_hole_add(uint8_t *lo, uint8_t *hi){
+    for (unsigned i = 0; i < g_rsv_nholes; ){
+        if (g_rsv_hole[i].hi == lo){ lo = g_rsv_hole[i].lo; rsv_hole_drop(i); }
+        else if (g_rsv_hole[i].lo == hi){ hi = g_rsv_hole[i].hi; rsv_hole_drop(i); }
+        else i++;
+    }
+    if (g_rsv_nholes == RSV_HOLES){ g_rsv_lost = 1; return; }
+    g_rsv_hole[g_rsv_nholes].lo = lo;
+    g_rsv_hole[g_rsv_nholes++].hi = hi;
+}
+
+// Commit bytes for an arena: the first hole that fits, else the top.
+static Arena* rsv_commit(size_t bytes){
+    bytes = ALIGN_UP(bytes, (size_t)sysconf(_SC_PAGESIZE));
+    if (!g_rsv_base) return NULL;
+    uint8_t *a = NULL;
+    unsigned i = 0;
+    while (i < g_rsv_nholes && (size_t)(g_rsv_hole[i].hi - g_rsv_hole[i].lo) < bytes) i++;
+    if (i < g_rsv_nholes) a = g_rsv_hole[i].lo;
+    else if (bytes <= (size_t)(g_rsv_end - g_rsv_top)) a = g_rsv_top;
+    else return NULL;
+    if (!g_rsv_prefault && mprotect(a, bytes, PROT_READ|PROT_WRITE) != 0) return NULL;
+    if (a == g_rsv_top) g_rsv_top += bytes;
+    else if ((g_rsv_hole[i].lo += bytes) == g_rsv_hole[i].hi) rsv_hole_drop(i);
+    Arena *ar = (Arena*)a;
+    ar->next = NULL;
+    ar->size = bytes;
+    return ar;
+}
+
+// Give an arena's pages back. Inside the reservation the range stays
+// reserved (and read-write when prefaulted) and goes back to rsv_commit:
+// the topmost arena lowers top, taking a hole just below along, and any
+// other becomes a hole.
+static void unmap_arena(Arena *ar){
+    uint8_t *a = (uint8_t*)ar;
+    size_t size = ar->size;
+    if (!rsv_contains(a)){ munmap(a, size); return; }
+    if (g_rsv_prefault) madvise(a, size, MADV_DONTNEED);
+    else mmap(a, size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|MAP_FIXED, -1, 0);
+    if (a + size != g_rsv_top){ rsv_hole_add(a, a + size); return; }
+    g_rsv_top = a;
+    for (unsigned i = 0; i < g_rsv_nholes; i++)
+        if (g_rsv_hole[i].hi == g_rsv_top){ g_rsv_top = g_rsv_hole[i].lo; rsv_hole_drop(i); break; }
+}
+
+// ======================= NUMA placement (mmu_numa_init) =======================
+// Once mmu_numa_init() finds several nodes, every general-heap arena belongs
+// to the node of the thread that mapped it and is mbind()ed there with
+// MPOL_PREFERRED, so a full node spills over instead of failing. Allocation
+// looks only at the calling thread's node: list strategies search that
+// node's arenas, tree strategies keep one tree per node, and a miss maps a
+// new arena on the node. A free goes back into the index of its own arena,
+// i.e. to the node that owns it; blocks parked on the quick lists are only
+// handed out again on their own node. The heap is still single-threaded;
+// the calling thread's node is where it runs now (sched_getcpu).
+//
+// MMU_NUMA_NODES=<n> in the environment fakes n nodes, with CPUs dealt out
+// round robin, so this can be tested on one node; only arenas of nodes that
+// really exist are bound. mmu_numa_set_node() pins the calling thread.
+#ifndef MMU_NUMA_MAX_NODES
+#define MMU_NUMA_MAX_NODES 64
+#endif
+#define MMU_NUMA_MAX_CPUS 4096
+#define MMU_MPOL_PREFERRED 1
+
+static unsigned g_numa_nodes = 1;       // nodes in use; 1 = placement off
+static unsigned g_numa_real = 1;        // nodes the kernel reports online
+static int g_numa_fake = 0;             // g_numa_nodes came from MMU_NUMA_NODES
+static uint16_t g_numa_cpu_node[MMU_NUMA_MAX_CPUS];
+static __thread int g_numa_pin = -1;
+static Arena *g_node_arenas[MMU_NUMA_MAX_NODES];
+static Block *g_node_avl[MMU_NUMA_MAX_NODES];  // trees of nodes 1..; node 0 keeps g_avl_root
+
+// Call fn(i, arg) for each i in a sysfs list such as "0-3,8"; 0 if unreadable.
+static int numa_read_list(const char *path, void (*fn)(unsigned, unsigned), unsigned arg){
+    char buf[1024];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return 0;
+    buf[n] = 0;
+    for (char *p = buf; *p >= '0' && *p <= '9';){
+        unsigned long a = strtoul(p, &p, 10), b = a;
+        if (*p == '-') b = strtoul(p + 1, &p, 10);
+        for (; a <= b; a++) fn((unsigned)a, arg);
+        if (*p == ',') p++;
+    }
+    return 1;
+}
+
+static void numa_note_node(unsigned node, unsigned arg){ (void)arg; if (node >= g_numa_real) g_numa_real = node + 1; }
+static void numa_note_cpu(unsigned cpu, unsigned node){ if (cpu < MMU_NUMA_MAX_CPUS) g_numa_cpu_node[cpu] = (uint16_t)node; }
+
+// Turn placement on if the machine has (or MMU_NUMA_NODES fakes) several
+// nodes, and return the node count in use; 1 means it stays off. Call it
+// at startup, before the heap grows.
+unsigned mmu_numa_init(void){
+    if (g_numa_nodes > 1) return g_numa_nodes;
+    numa_read_list("/sys/devices/system/node/online", numa_note_node, 0);
+    for (unsigned n = 0; n < g_numa_real; n++){
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", n);
+        numa_read_list(path, numa_note_cpu, n);
+    }
+    const char *fake = getenv("MMU_NUMA_NODES");
+    unsigned nodes = fake ? (unsigned)atoi(fake) : g_numa_real;
+    g_numa_fake = fake != NULL;
+    if (nodes > MMU_NUMA_MAX_NODES) nodes = MMU_NUMA_MAX_NODES;
+    if (nodes > 1) g_numa_nodes = nodes;
+    return g_numa_nodes;
+}
+
+static inline unsigned numa_node(void){
+    if (g_numa_pin >= 0) return (unsigned)g_numa_pin;
+#ifdef __USE_GNU
+    int cpu = sched_getcpu();
+#else
+    // Included after libc headers without _GNU_SOURCE: no prototype (vDSO lost).
+    unsigned c;
+    int cpu = syscall(SYS_getcpu, &c, NULL, NULL) == 0 ? (int)c : -1;
+#endif
+    if (cpu < 0) return 0;
+    if (g_numa_fake) return (unsigned)cpu % g_numa_nodes;
+    return cpu < MMU_NUMA_MAX_CPUS ? g_numa_cpu_node[cpu] % g_numa_nodes : 0;
+}
+
+// Pin the calling thread's allocations to node (-1 unpins); 0 if no such node.
+int mmu_numa_set_node(int node){
+    if (node >= (int)g_numa_nodes) return 0;
+    g_numa_pin = node < 0 ? -1 : node;
+    return 1;
+}
+
+// Node of the general-heap arena holding p, -1 if the general heap does not own p.
+int mmu_numa_node_of(const void *p){
+    uintptr_t e = pagemap_get(p);
+    return pm_kind(e) == OWN_ARENA ? (int)((Arena*)pm_owner(e))->node : -1;
+}
+
+static inline unsigned blk_node(Block *b){
+    return g_numa_nodes > 1 ? ((Arena*)pm_owner(pagemap_get(b)))->node : 0;
+}
+
+static inline Block** avl_root_of(unsigned node){ return node ? &g_node_avl[node] : &g_avl_root; }
+
+static inline int avl_all_empty(void){
+    for (unsigned n = 0; n < g_numa_nodes; n++) if (*avl_root_of(n)) return 0;
+    return 1;
+}
+
+static void numa_place(Arena *ar, unsigned node){
+    ar->node = node;
+    ar->node_next = g_node_arenas[node];
+    g_node_arenas[node] = ar;
+    if (g_numa_nodes == 1 || node >= g_numa_real) return;   // off, or a fake node
+    unsigned long mask[(MMU_NUMA_MAX_NODES + 63) / 64] = {0};
+    mask[node / 64] |= 1ul << (node % 64);
+    syscall(SYS_mbind, (void*)ar, ar->size, MMU_MPOL_PREFERRED, mask, (unsigned long)MMU_NUMA_MAX_NODES + 1, 0ul);
+}
+
+static void numa_unplace(Arena *ar){
+    Arena **pp = &g_node_arenas[ar->node];
+    while (*pp != ar) pp = &(*pp)->node_next;
+    *pp = ar->node_next;
+}
+
+static size_t g_arena_bytes = 0;    // bytes mapped by general-heap arenas
+
+static inline Block* arena_first_blk(Arena *ar){ return (Block*)((uint8_t*)ar + ARENA_HDR_SZ); }
+
+// Map a general-heap arena with room for min_usable bytes and return its one
+// free block unindexed, so the caller can split it in place. Each new arena
+// is as large as the heap so far until that reaches ARENA_MAX, and ARENA_MAX
+// after: a few mmap calls up to the cap, then one per ARENA_MAX bytes (256
+// for a 1GB heap at the default 4MB). The cap leaves next fit several
+// arenas to skip between.
+static Block* map_arena(size_t min_usable){
+    size_t need = ARENA_HDR_SZ + HDR_SZ + min_usable;
+    size_t grow = g_arena_bytes < ARENA_MAX ? g_arena_bytes : ARENA_MAX;
+    if (need < grow) need = grow;
+    if (need < ARENA_MIN) need = ARENA_MIN;
+
+    MMU_TIME_BEGIN(t);
+    Arena *ar = rsv_commit(need);
+    if (!ar) ar = map_arena_raw(need);
+    if (ar && !pagemap_set(ar, ar->size, OWN_ARENA, ar)){ unmap_arena(ar); ar = NULL; }
+    MMU_TIME_END(arena_map, t, need);
+    if (!ar) return NULL;
+    need = ar->size;
+    ar->fl_seg_shift = (uint8_t)(64 - __builtin_clzll((unsigned long long)(need - 1)) - __builtin_ctz(FL_SEGS));
+    ar->next = g_arenas;
+    g_arenas = ar;
+    g_arena_bytes += need;
+    numa_place(ar, g_numa_nodes > 1 ? numa_node() : 0);
+
+    Block *b = arena_first_blk(ar);
+    b->prev_size = 0;
+    b->head = (need - ARENA_HDR_SZ - HDR_SZ) | BLK_FREE | BLK_LAST;
+    b->next_free = NULL;
+    b->avl.l = b->avl.r = NULL;
+    b->avl.h = 1;
+    return b;
+}
+
+int mmu_reserve(size_t bytes, int prefault);
+
+__attribute__((constructor))
+static void init_once(void){
+#ifdef MMU_NUMA
+    mmu_numa_init();
+#endif
+#ifdef MMU_RESERVE_BYTES
+    if (mmu_reserve(MMU_RESERVE_BYTES, MMU_RESERVE_PREFAULT)) return;
+#endif
+    Block *b = map_arena(ARENA_MIN);
+    if (b) index_insert(b);
+}
+
+// Reserve bytes of address space for the general heap; with prefault, map
+// and fault it all in now. Call once, early in startup: if the heap is
+// still just the empty arena init_once mapped, that arena moves into the
+// reservation too. Returns 1 on success, 0 if already reserved or on mmap
+// failure.
+int mmu_reserve(size_t bytes, int prefault){
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (g_rsv_base || bytes == 0) return 0;
+    bytes = ALIGN_UP(bytes, page);
+    void *mem = prefault
+        ? mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_POPULATE, -1, 0)
+        : mmap(NULL, bytes, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) return 0;
+    if (prefault) madvise(mem, bytes, MADV_WILLNEED);
+    g_rsv_base = g_rsv_top = (uint8_t*)mem;
+    g_rsv_end = g_rsv_base + bytes;
+    g_rsv_prefault = prefault;
+
+    Arena *ar = g_arenas;
+    Block *b = ar ? arena_first_blk(ar) : NULL;
+    if (ar && (ar->next || !blk_is_free(b) || !blk_is_last(b) || g_migrating != STRAT_UNSET)) return 1;
+    if (ar){
+        index_remove(b);
+        g_arenas = NULL;
+        g_arena_bytes -= ar->size;
+        numa_unplace(ar);
+        pagemap_set(ar, ar->size, OWN_NONE, NULL);
+        munmap(ar, ar->size);
+    }
+    if ((b = map_arena(ARENA_MIN))) index_insert(b);
+    return 1;
+}
+
+// The first/next-fit free list is address-ordered and doubly linked, so a
+// block leaves it in O(1). Insertion walks in whichever direction the
+// address lies from the nearest block the arena's segment summary knows
+// (below), or from a finger (the last block touched) when the arena has no
+// free blocks yet.
+//
+// Free sizes are summarised per size class, heap-wide and per arena. A
+// request larger than every block in the top non-empty class fails in O(1),
+// and scans jump over arenas whose summary rules them out.
+//
+// Within an arena, first fit also skips segments. Each segment knows its
+// first free block and a bound on its largest class; the bound is raised on
+// insert, left stale on removal, and made exact again whenever a scan walks
+// the whole segment. The bounds sit in one byte array, so finding the next
+// segment that may fit is a kern_find_ge over it instead of one header per
+// cache miss.
+static Block *g_fl_finger = NULL;
+static size_t g_fl_class_count[64];
+static uint64_t g_fl_class_mask = 0;
+
+static inline unsigned fl_class(size_t size){ return 63u - (unsigned)__builtin_clzll((unsigned long long)size); }
+
+static inline int fl_mask_may_fit(uint64_t mask, size_t need){
+    if (!mask) return 0;
+    unsigned top = 63u - (unsigned)__builtin_clzll(mask);
+    return top >= 63 || need < ((size_t)2 << top);
+}
+
+static inline Arena* fl_arena_of(Block *b){ return (Arena*)pm_owner(pagemap_get(b)); }
+static inline int fl_in_arena(Arena *ar, Block *b){ return (uintptr_t)b - (uintptr_t)ar < ar->size; }
+
+static inline unsigned fl_seg(Arena *ar, Block *b){ return (unsigned)(((uintptr_t)b - (uintptr_t)ar) >> ar->fl_seg_shift); }
+static inline uint32_t fl_seg_off(Arena *ar, Block *b){ return (uint32_t)(((uintptr_t)b - (uintptr_t)ar) / ALIGN); }
+static inline Block* fl_seg_block(Arena *ar, unsigned s){
+    return ar->fl_seg_first[s] ? (Block*)((uint8_t*)ar + (size_t)ar->fl_seg_first[s] * ALIGN) : NULL;
+}
+
+// First segment from s on whose bound reaches class c (FL_SEGS if none).
+// Empty segments hold 0.
+static inline unsigned fl_seg_scan(Arena *ar, unsigned s, unsigned c){
+    return s + (unsigned)kern_find_ge(ar->fl_seg_max + s, FL_SEGS - s, c);
+}
+
+static void fl_push_sorted(Block *b){
+    Arena *ar = fl_arena_of(b);
+    Block *prev = NULL, *next = g_free_head;
+    Block *f = g_fl_finger;
+    if (ar->fl_first){
+        unsigned s = fl_seg(ar, b), t;
+        if (!(f = fl_seg_block(ar, s)) && (t = fl_seg_scan(ar, s + 1, 1)) < FL_SEGS) f = fl_seg_block(ar, t);
+        if (!f) f = ar->fl_last;
+    }
+    size_t steps = 0;
+    if (f && f < b){
+        prev = f; next = f->next_free;
+        while (next && next < b){ prev = next; next = next->next_free; steps++; }
+    } else if (f){
+        next = f; prev = f->prev_free;
+        while (prev && prev > b){ next = prev; prev = prev->prev_free; steps++; }
+    } else {
+        while (next && next < b){ prev = next; next = next->next_free; steps++; }
+    }
+    g_fl_steps += steps;
+    b->avl.h = 0;           // list membership, told apart from tree nodes while migrating
+    b->prev_free = prev;
+    b->next_free = next;
+    if (prev) prev->next_free = b; else g_free_head = b;
+    if (next) next->prev_free = b;
+    g_fl_finger = b;
+
+    unsigned c = fl_class(blk_size(b));
+    g_fl_class_count[c]++;
+    g_fl_class_mask |= (uint64_t)1 << c;
+
+    if (!ar->fl_first || b < ar->fl_first) ar->fl_first = b;
+    if (!ar->fl_last || b > ar->fl_last) ar->fl_last = b;
+    ar->fl_count[c]++;
+    ar->fl_mask |= (uint64_t)1 << c;
+    unsigned s = fl_seg(ar, b);
+    Block *sf = fl_seg_block(ar, s);
+    if (!sf || b < sf) ar->fl_seg_first[s] = fl_seg_off(ar, b);
+    if (c > ar->fl_seg_max[s]) ar->fl_seg_max[s] = (uint8_t)c;
+}
+
+static void fl_remove(Block *b){
+    Arena *ar = fl_arena_of(b);
+    if (ar->fl_first == b) ar->fl_first = (b->next_free && fl_in_arena(ar, b->next_free)) ? b->next_free : NULL;
+    if (ar->fl_last == b) ar->fl_last = (b->prev_free && fl_in_arena(ar, b->prev_free)) ? b->prev_free : NULL;
+    unsigned s = fl_seg(ar, b);
+    if (fl_seg_block(ar, s) == b){
+        Block *n = b->next_free;
+        if (n && fl_in_arena(ar, n) && fl_seg(ar, n) == s) ar->fl_seg_first[s] = fl_seg_off(ar, n);
+        else ar->fl_seg_first[s] = 0, ar->fl_seg_max[s] = 0;
+    }
+
+    if (b->prev_free) b->prev_free->next_free = b->next_free;
+    else g_free_head = b->next_free;
+    if (b->next_free) b->next_free->prev_free = b->prev_free;
+    if (g_nextfit_cursor == b) g_nextfit_cursor = b->next_free;
+    if (g_fl_finger == b)
+        g_fl_finger = b->prev_free ? b->prev_free : b->next_free;
+
+    unsigned c = fl_class(blk_size(b));
+    if (g_fl_class_count[c] && --g_fl_class_count[c] == 0) g_fl_class_mask &= ~((uint64_t)1 << c);
+    if (ar->fl_count[c] && --ar->fl_count[c] == 0) ar->fl_mask &= ~((uint64_t)1 << c);
+    b->next_free = b->prev_free = NULL;
+}
+
+// Step to the next candidate after cur, skipping to the end of any arena
+// run whose summary cannot satisfy need. *ar caches cur's arena.
+static inline Block* fl_advance(Block *cur, size_t need, Arena **ar){
+    if (!cur) return NULL;
+    if (!*ar || !fl_in_arena(*ar, cur)){
+        *ar = fl_arena_of(cur);
+        if (!fl_mask_may_fit((*ar)->fl_mask, need)) return (*ar)->fl_last->next_free;
+    }
+    return cur;
+}
+
+// The scan always enters a segment at its first free block, so a segment it
+// leaves without a fit has been walked whole and its bound can be reset.
+static Block* fl_first_fit(size_t need){
+    if (!fl_mask_may_fit(g_fl_class_mask, need)) return NULL;
+    unsigned cneed = fl_class(need), seg = FL_SEGS, top = 0;
+    Arena *ar = NULL;
+    Block *cur = g_free_head, *next;
+    size_t steps = 0;
+    while (cur){
+        steps++;
+        if ((next = fl_advance(cur, need, &ar)) != cur){ cur = next; seg = FL_SEGS; continue; }
+        unsigned s = fl_seg(ar, cur);
+        if (s != seg){
+            seg = s;
+            top = 0;
+            if (ar->fl_seg_max[s] < cneed){
+                unsigned t = fl_seg_scan(ar, s + 1, cneed);
+                cur = t < FL_SEGS ? fl_seg_block(ar, t) : ar->fl_last->next_free;
+                continue;
+            }
+        }
+        next = cur->next_free;
+        __builtin_prefetch(next);
+        size_t sz = blk_size(cur);
+        if (sz >= need) break;
+        if (fl_class(sz) > top) top = fl_class(sz);
+        if (!next || !fl_in_arena(ar, next) || fl_seg(ar, next) != seg) ar->fl_seg_max[seg] = (uint8_t)top;
+        cur = next;
+    }
+    g_fl_steps += steps;
+    return cur;
+}
+
+// Resume after the previous hit and wrap once; the list is address-ordered,
+// so the pass ends at the first block at or beyond the starting point.
+static Block* fl_next_fit(size_t need){
+    if (!fl_mask_may_fit(g_fl_class_mask, need)) return NULL;
+    Block *start = g_nextfit_cursor ? g_nextfit_cursor : g_free_head;
+    Block *cur = start, *next;
+    Arena *ar = NULL;
+    int wrapped = 0;
+    for (;;){
+        if (!cur){
+            if (wrapped) return NULL;
+            wrapped = 1;
+            cur = g_free_head;
+            continue;
+        }
+        if (wrapped && cur >= start) return NULL;
+        if ((next = fl_advance(cur, need, &ar)) != cur){ cur = next; continue; }
+        if (blk_size(cur) >= need){
+            g_nextfit_cursor = cur->next_free;
+            return cur;
+        }
+        cur = cur->next_free;
+    }
+}
+
+static inline size_t key_size(Block *b){ return blk_size(b); }
+static inline uintptr_t key_addr(Block *b){ return (uintptr_t)(void*)b; }
+
+static int cmp_block(Block *a, Block *b){
+    if (key_size(a) < key_size(b)) return -1;
+    if (key_size(a) > key_size(b)) return 1;
+    if (key_addr(a) < key_addr(b)) return -1;
+    if (key_addr(a) > key_addr(b)) return 1;
+    return 0;
+}
+
+static int8_t height(Block *n){ return n ? n->avl.h : 0; }
+
+static void upd(Block *n){
+    int8_t hl = height(n->avl.l), hr = height(n->avl.r);
+    n->avl.h = (hl > hr ? hl : hr) + 1;
+}
+
+static Block* rotR(Block *y){
+    Block *x = y->avl.l, *T2 = x->avl.r;
+    x->avl.r = y;
+    y->avl.l = T2;
+    upd(y);
+    upd(x);
+    return x;
+}
+
+static Block* rotL(Block *x){
+    Block *y = x->avl.r, *T2 = y->avl.l;
+    y->avl.l = x;
+    x->avl.r = T2;
+    upd(x);
+    upd(y);
+    return y;
+}
+
+static int balance_factor(Block *n){ return n ? height(n->avl.l) - height(n->avl.r) : 0; }
+
+static Block* avl_insert_rec(Block *root, Block *node){
+    if (!root) return node;
+    int c = cmp_block(node, root);
+    if (c < 0) root->avl.l = avl_insert_rec(root->avl.l, node);
+    else if (c > 0) root->avl.r = avl_insert_rec(root->avl.r, node);
+    else return root;
+    upd(root);
+    int bf = balance_factor(root);
+    if (bf > 1 && cmp_block(node, root->avl.l) < 0) return rotR(root);
+    if (bf < -1 && cmp_block(node, root->avl.r) > 0) return rotL(root);
+    if (bf > 1 && cmp_block(node, root->avl.l) > 0){
+        root->avl.l = rotL(root->avl.l);
+        return rotR(root);
+    }
+    if (bf < -1 && cmp_block(node, root->avl.r) < 0){
+        root->avl.r = rotR(root->avl.r);
+        return rotL(root);
+    }
+    return root;
+}
+
+// Both children are prefetched on the way down: the branch on the size is
+// hard to predict, so the child taken is often not the one speculated.
+static Block* avl_lower_bound(Block *root, size_t need){
+    Block *ans = NULL;
+    while (root){
+        __builtin_prefetch(root->avl.l);
+        __builtin_prefetch(root->avl.r);
+        if (need <= blk_size(root)){ ans = root; root = root->avl.l; }
+        else root = root->avl.r;
+    }
+    return ans;
+}
+
+// Find the rightmost (largest) block >= need in O(log n) time. Larger blocks
+// are always to the right, so the descent only ever takes the right child.
+static Block* avl_rightmost_ge(Block *root, size_t need){
+    Block *ans = NULL;
+    while (root){
+        __builtin_prefetch(root->avl.r);
+        if (blk_size(root) >= need) ans = root;
+        root = root->avl.r;
+    }
+    return ans;
+}
+
+static Block* avl_min(Block *n){
+    while(n && n->avl.l) n = n->avl.l;
+    return n;
+}
+
+static Block* avl_delete_rec(Block *root, Block *node){
+    if (!root) return NULL;
+    int c = cmp_block(node, root);
+    if (c < 0){
+        root->avl.l = avl_delete_rec(root->avl.l, node);
+    } else if (c > 0){
+        root->avl.r = avl_delete_rec(root->avl.r, node);
+    } else {
+        if (!root->avl.l) return root->avl.r;
+        if (!root->avl.r) return root->avl.l;
+        Block *s = avl_min(root->avl.r);
+        root->avl.r = avl_delete_rec(root->avl.r, s);
+        s->avl.l = root->avl.l;
+        s->avl.r = root->avl.r;
+        root = s;
+    }
+    upd(root);
+    int bf = balance_factor(root);
+    if (bf > 1 && balance_factor(root->avl.l) >= 0) return rotR(root);
+    if (bf > 1 && balance_factor(root->avl.l) < 0){
+        root->avl.l = rotL(root->avl.l);
+        return rotR(root);
+    }
+    if (bf < -1 && balance_factor(root->avl.r) <= 0) return rotL(root);
+    if (bf < -1 && balance_factor(root->avl.r) > 0){
+        root->avl.r = rotR(root->avl.r);
+        return rotL(root);
+    }
+    return root;
+}
+
+static void avl_insert(Block *b){
+    b->avl.l = b->avl.r = NULL;
+    b->avl.h = 1;
+    Block **root = avl_root_of(blk_node(b));
+    *root = avl_insert_rec(*root, b);
+}
+
+static void avl_erase(Block *b){
+    Block **root = avl_root_of(blk_node(b));
+    *root = avl_delete_rec(*root, b);
+}
+
+// ======================= Index dispatch (strict independence) =======================
+// The *_as forms take the strategy as an argument so the specialised
+// instances can pass a constant and have the dispatch folded away.
+// STRAT_AUTO there means "decide at run time": g_strat, and either index
+// while STRAT_AUTO migrates.
+#define MMU_HOT static inline __attribute__((always_inline))
+
+MMU_HOT void index_insert_as(Strategy s, Block *b){
+    if (s == STRAT_AUTO) s = g_strat;
+    g_free_blocks++;
+    g_free_bytes += blk_size(b);
+    if (s == STRAT_BEST || s == STRAT_WORST){
+        avl_insert(b);
+    } else {
+        fl_push_sorted(b);
+    }
+}
+
+MMU_HOT void index_remove_as(Strategy s, Block *b){
+    // Mid-migration a block sits in either index; list entries have h == 0.
+    if (s == STRAT_AUTO) s = g_migrating == STRAT_UNSET ? g_strat : b->avl.h ? STRAT_BEST : STRAT_FIRST;
+    g_free_blocks--;
+    g_free_bytes -= blk_size(b);
+    if (s == STRAT_BEST || s == STRAT_WORST){
+        avl_erase(b);
+    } else {
+        fl_remove(b);
+    }
+}
+
+// NUMA: the strategy restricted to one node's blocks. Tree strategies have
+// the node's own tree; the list ones walk the node's arenas, which keep
+// their list segments summarised, and next fit becomes first fit there.
+static Block* index_find_node(Strategy s, size_t need, unsigned node){
+    if (s == STRAT_BEST)  return avl_lower_bound(*avl_root_of(node), need);
+    if (s == STRAT_WORST) return avl_rightmost_ge(*avl_root_of(node), need);
+    if (!fl_mask_may_fit(g_fl_class_mask, need)) return NULL;
+    unsigned c = fl_class(need);
+    for (Arena *ar = g_node_arenas[node]; ar; ar = ar->node_next){
+        if (!fl_mask_may_fit(ar->fl_mask, need)) continue;
+        for (unsigned t = fl_seg_scan(ar, 0, c); t < FL_SEGS; t = fl_seg_scan(ar, t + 1, c))
+            for (Block *b = fl_seg_block(ar, t); b && fl_in_arena(ar, b) && fl_seg(ar, b) == t; b = b->next_free)
+                if (blk_size(b) >= need) return b;
+    }
+    return NULL;
+}
+
+static inline Block* index_find_in(Strategy s, size_t need){
+    if (g_numa_nodes > 1)  return index_find_node(s, need, numa_node());
+    if (s == STRAT_FIRST)  return fl_first_fit(need);
+    if (s == STRAT_NEXT)   return fl_next_fit(need);
+    if (s == STRAT_BEST)   return avl_lower_bound(g_avl_root, need);
+    if (s == STRAT_WORST)  return avl_rightmost_ge(g_avl_root, need);
+    return fl_first_fit(need);
+}
+
+// While STRAT_AUTO migrates, blocks not yet moved are found in the old index.
+MMU_HOT Block* index_find_as(Strategy s, size_t need){
+    if (s != STRAT_AUTO) return index_find_in(s, need);
+    Block *b = index_find_in(g_strat, need);
+    if (!b && g_migrating != STRAT_UNSET) b = index_find_in(g_migrating, need);
+    return b;
+}
+
+static void index_insert(Block *b){ index_insert_as(STRAT_AUTO, b); }
+static void index_remove(Block *b){ index_remove_as(STRAT_AUTO, b); }
+static Block* index_find(size_t need){ return index_find_as(STRAT_AUTO, need); }
+
+// ======================= Split & Coalesce (index-agnostic) =======================
+
+MMU_HOT Block* split_block_as(Strategy s, Block *b, size_t need){
+    size_t left = blk_size(b) - need;
+    size_t min_split = HDR_SZ + MIN_PAYLOAD;
+    if (left < min_split) return b;
+
+    uint8_t *base = (uint8_t*)b;
+    Block *alloc = b;
+    Block *rem = (Block*)(base + HDR_SZ + need);
+
+    rem->prev_size = need;
+    rem->head = (left - HDR_SZ) | BLK_FREE | (alloc->head & BLK_LAST);
+    blk_sync_next(rem);
+
+    rem->next_free = NULL;
+    rem->avl.l = rem->avl.r = NULL; rem->avl.h = 1;
+
+    alloc->head = need | (alloc->head & BLK_FREE);
+
+    index_insert_as(s, rem);
+    return alloc;
+}
+
+static Block* split_block(Block *b, size_t need){ return split_block_as(STRAT_AUTO, b, need); }
+
+MMU_HOT void coalesce_and_insert_as(Strategy s, Block *b){
+    MMU_TIME_BEGIN(t);
+    Block *L = blk_prev_phys(b), *R = blk_next_phys(b);
+
+    if (L && blk_is_free(L)){
+        index_remove_as(s, L);
+        L->head = (blk_size(L) + HDR_SZ + blk_size(b)) | BLK_FREE | (b->head & BLK_LAST);
+        b = L;
+    }
+
+    if (R && blk_is_free(R)){
+        index_remove_as(s, R);
+        b->head = (blk_size(b) + HDR_SZ + blk_size(R)) | BLK_FREE | (R->head & BLK_LAST);
+    }
+    blk_sync_next(b);
+    blk_absorbed(b);
+
+    b->next_free = NULL;
+    b->avl.l = b->avl.r = NULL;
+    b->avl.h = 1;
+
+    index_insert_as(s, b);
+    MMU_TIME_END(coalesce, t, blk_size(b));
+}
+
+static void coalesce_and_insert(Block *b){ coalesce_and_insert_as(STRAT_AUTO, b); }
+
+// ======================= Quick-lists (deferred coalescing) =======================
+// In lazy mode a freed small block keeps looking allocated to its neighbours
+// and is parked on a per-size LIFO. Same-size requests take it back without
+// touching the index; coalescing runs only on a miss or past QUICK_LIMIT.
+
+static int g_lazy_coalesce = 0;
+static Block *g_quick[QUICK_BINS];
+static size_t g_quick_count = 0;
+
+static inline size_t quick_bin(size_t size){ return (size - MIN_PAYLOAD) / ALIGN; }
+
+static void quick_flush(void){
+    for (size_t i = 0; i < QUICK_BINS; i++){
+        Block *b = g_quick[i];
+        g_quick[i] = NULL;
+        while (b){
+            Block *next = b->next_free;
+            b->head = (b->head & ~BLK_QUICK) | BLK_FREE;
+            coalesce_and_insert(b);
+            b = next;
+        }
+    }
+    g_quick_count = 0;
+}
+
+void allocator_set_lazy_coalesce(int on){
+    if (!on && g_lazy_coalesce) quick_flush();
+    g_lazy_coalesce = on;
+}
+
+// ======================= Adaptive strategy (STRAT_AUTO) =======================
+// STRAT_AUTO starts on the address-ordered list (first fit) and re-decides
+// every AUTO_WINDOW allocations and frees from what the window observed.
+//
+// Index: a list operation costs AUTO_LIST_BASE plus AUTO_LIST_STEP per node
+// its lookup or insertion walked (measured; list nodes are scattered, tree
+// tops stay cached); a tree operation costs AUTO_TREE_COST per level of a
+// balanced tree over the free blocks. When the list costs more, the heap
+// moves to the tree (best fit). The tree cannot measure what the list would
+// cost, so the list is retried every g_auto_probe windows if the tree's cost
+// exceeds the last list cost seen, which decays by half per probe; a retry
+// that loses at once doubles the probe interval (up to AUTO_PROBE_MAX
+// windows). A list window closes early once it has walked AUTO_LIST_CAP
+// nodes per operation of a full window, which bounds what a retry costs.
+//
+// A switch flips g_strat at once and migrates free blocks behind a physical
+// walk of the arenas, a few per operation, so blocks reach a new list in
+// address order. Until the walk ends, lookups that miss the new index try
+// the old one.
+//
+// Quick-lists: on when at least half the allocations could reuse a size
+// freed earlier in the window, off when they serve fewer than a quarter or
+// fragmentation (1 - largest free block / free bytes) has grown by more than
+// AUTO_FRAG_GROWTH points since they were turned on. Turning them off for
+// too few hits holds them off for a backoff that doubles each time; an index
+// switch marks a new workload and clears it. The switches are
+// heap-wide: all arenas share one index.
+
+#ifndef AUTO_WINDOW
+#define AUTO_WINDOW 1024
+#endif
+#define AUTO_MIGRATE_STEP 16
+#define AUTO_LIST_BASE 12
+#define AUTO_LIST_STEP 3
+#define AUTO_LIST_CAP 64
+#define AUTO_TREE_COST 6
+#define AUTO_PROBE_MIN 4
+#define AUTO_PROBE_MAX 256
+#define AUTO_FRAG_GROWTH 25
+
+typedef struct {
+    uint32_t allocs, frees;
+    uint32_t reuse;                 // allocations whose quick bin had an unmatched free
+    uint32_t quick_hits;
+    uint64_t steps0;                // g_fl_steps when the window opened
+    uint8_t pending[QUICK_BINS];    // unmatched frees per quick bin (saturating)
+} AutoStats;
+
+static AutoStats g_auto_stats;
+static Arena *g_migrate_arena = NULL;
+static uint32_t g_auto_windows = 0;                 // full windows since the last switch
+static uint32_t g_auto_probe = AUTO_PROBE_MIN;
+static uint64_t g_auto_list_cost = 0;               // last list cost per operation seen
+static size_t g_auto_frag_on = 0;                   // fragmentation when quick-lists went on
+static uint32_t g_auto_lazy_hold = 0;               // windows before quick-lists may return
+static uint32_t g_auto_lazy_backoff = 1;
+
+static void auto_window_reset(void){
+    memset(&g_auto_stats, 0, sizeof(g_auto_stats));
+    g_auto_stats.steps0 = g_fl_steps;
+}
+
+static void auto_switch(Strategy to){
+    g_migrating = g_strat;
+    g_strat = to;
+    g_migrate_arena = g_arenas;
+    g_migrate_cursor = g_arenas ? arena_first_blk(g_arenas) : NULL;
+    g_auto_windows = 0;
+    g_auto_lazy_hold = 0;
+    g_auto_lazy_backoff = 1;
+}
+
+// Move up to AUTO_MIGRATE_STEP free blocks still in the old index.
+static void auto_migrate(void){
+    int old_list = g_migrating == STRAT_FIRST;
+    for (int visits = 0, moved = 0; moved < AUTO_MIGRATE_STEP && visits < 8 * AUTO_MIGRATE_STEP; visits++){
+        Block *b = g_migrate_cursor;
+        if (!b){
+            if (!g_migrate_arena || !(g_migrate_arena = g_migrate_arena->next)){
+                assert(old_list ? !g_free_head : avl_all_empty());
+                g_migrating = STRAT_UNSET;
+                auto_window_reset();
+                return;
+            }
+            g_migrate_cursor = arena_first_blk(g_migrate_arena);
+            continue;
+        }
+        g_migrate_cursor = blk_next_phys(b);
+        if (blk_is_free(b) && (b->avl.h == 0) == old_list){
+            index_remove(b);
+            index_insert(b);
+            moved++;
+        }
+    }
+}
+
+// Fragmentation in percent. The largest free block is exact from the tree
+// and a power-of-two lower bound from the list's size classes.
+static size_t auto_frag(void){
+    size_t best = 0;
+    for (unsigned n = 0; n < g_numa_nodes; n++)
+        for (Block *b = *avl_root_of(n); b; b = b->avl.r)
+            if (blk_size(b) > best) best = blk_size(b);
+    if (g_fl_class_mask && g_free_head){
+        size_t lo = (size_t)1 << (63u - (unsigned)__builtin_clzll(g_fl_class_mask));
+        if (lo > best) best = lo;
+    }
+    return g_free_bytes ? 100 - best * 100 / g_free_bytes : 0;
+}
+
+static void auto_decide(void){
+    AutoStats *st = &g_auto_stats;
+    uint64_t ops = (uint64_t)st->allocs + st->frees;
+    uint64_t tree = AUTO_TREE_COST * (64u - (unsigned)__builtin_clzll((unsigned long long)g_free_blocks | 1));
+    if (g_migrating == STRAT_UNSET){
+        g_auto_windows++;
+        if (g_strat == STRAT_FIRST){
+            g_auto_list_cost = AUTO_LIST_BASE + AUTO_LIST_STEP * (g_fl_steps - st->steps0) / ops;
+            if (g_auto_list_cost > tree){
+                // A retry that lost in its first window backs off further.
+                if (g_auto_windows > 1) g_auto_probe = AUTO_PROBE_MIN;
+                else if (g_auto_probe < AUTO_PROBE_MAX) g_auto_probe *= 2;
+                auto_switch(STRAT_BEST);
+            }
+        } else if (g_auto_windows >= g_auto_probe){
+            if (tree > g_auto_list_cost) auto_switch(STRAT_FIRST);
+            else { g_auto_windows = 0; g_auto_list_cost /= 2; }
+        }
+    }
+    if (!g_lazy_coalesce){
+        if (g_auto_lazy_hold) g_auto_lazy_hold--;
+        else if (st->reuse * 2 >= st->allocs){
+            allocator_set_lazy_coalesce(1);
+            g_auto_frag_on = auto_frag();
+        }
+    } else if (st->quick_hits * 4 < st->allocs){
+        allocator_set_lazy_coalesce(0);
+        g_auto_lazy_hold = g_auto_lazy_backoff;
+        if (g_auto_lazy_backoff < AUTO_PROBE_MAX) g_auto_lazy_backoff *= 2;
+    } else if (auto_frag() > g_auto_frag_on + AUTO_FRAG_GROWTH){
+        allocator_set_lazy_coalesce(0);
+    }
+    auto_window_reset();
+}
+
+static inline void auto_tick(void){
+    if (g_migrating != STRAT_UNSET) auto_migrate();
+    if (g_auto_stats.allocs + g_auto_stats.frees >= AUTO_WINDOW ||
+        g_fl_steps - g_auto_stats.steps0 >= (uint64_t)AUTO_LIST_CAP * AUTO_WINDOW) auto_decide();
+}
+
+static inline void auto_note_alloc(size_t size){
+    size_t q = quick_bin(size);
+    g_auto_stats.allocs++;
+    if (q < QUICK_BINS && g_auto_stats.pending[q]){ g_auto_stats.pending[q]--; g_auto_stats.reuse++; }
+    auto_tick();
+}
+
+static inline void auto_note_free(size_t size){
+    size_t q = quick_bin(size);
+    g_auto_stats.frees++;
+    if (q < QUICK_BINS && g_auto_stats.pending[q] < UINT8_MAX) g_auto_stats.pending[q]++;
+    auto_tick();
+}
+
+// ======================= Allocation core (general heap) =======================
+
+// quick is the quick-list mode of a specialised instance; with STRAT_AUTO
+// it is ignored and g_lazy_coalesce is read instead.
+MMU_HOT Block* allocate_general_as(Strategy s, int quick, size_t size){
+    if (size == 0) return NULL;
+    size = ALIGN_UP(size, ALIGN);
+    if (size < MIN_PAYLOAD) size = MIN_PAYLOAD;
+    if (s == STRAT_AUTO && g_auto) auto_note_alloc(size);
+
+    if (s == STRAT_AUTO ? g_lazy_coalesce : quick){
+        size_t q = quick_bin(size);
+        // Under NUMA a parked block of another node is a miss; the flush
+        // below hands it back to its own node's index.
+        if (q < QUICK_BINS && g_quick[q] && (g_numa_nodes == 1 || blk_node(g_quick[q]) == numa_node())){
+            Block *hit = g_quick[q];
+            g_quick[q] = hit->next_free;
+            g_quick_count--;
+            hit->head &= ~BLK_QUICK;
+            if (s == STRAT_AUTO && g_auto) g_auto_stats.quick_hits++;
+            return hit;
+        }
+        if (g_quick_count) quick_flush();
+    }
+
+    MMU_TIME_BEGIN(tf);
+    Block *b = index_find_as(s, size);
+    MMU_TIME_END(index_find, tf, size);
+    if (b){
+        MMU_TIME_BEGIN(tr);
+        index_remove_as(s, b);
+        MMU_TIME_END(index_remove, tr, blk_size(b));
+    } else if (!(b = map_arena(size))) return NULL;
+
+    MMU_TIME_BEGIN(ts);
+    b = split_block_as(s, b, size);
+    MMU_TIME_END(split, ts, size);
+    b->head &= ~BLK_FREE;
+    return b;
+}
+
+static Block* allocate_general(size_t size){ return allocate_general_as(STRAT_AUTO, 0, size); }
+
+// ======================= Public malloc flavors (lock-in strategy) =======================
+
+// The constructor's arena is indexed before any strategy is locked, in the
+// list; a tree strategy takes its blocks over when it is locked. STRAT_AUTO
+// starts on the list.
+static int lock_strategy(Strategy s){
+    if (g_strat == STRAT_UNSET){
+        Block *b;
+        if (s == STRAT_AUTO){ g_auto = 1; s = STRAT_FIRST; }
+        g_strat = s;
+        if (s == STRAT_BEST || s == STRAT_WORST)
+            while ((b = g_free_head)){ index_remove_as(STRAT_FIRST, b); index_insert(b); }
+        return 1;
+    }
+    if (g_auto ? s != STRAT_AUTO : g_strat != s){
+        fprintf(stderr, "[allocator] ERROR: mixed strategies in one run (%d vs %d)\n",(int)(g_auto ? STRAT_AUTO : g_strat),(int)s);
+        abort();
+    }
+    return 1;
+}
+
+void allocator_init(Strategy s){ lock_strategy(s); }
+
+static inline void* malloc_general(Strategy s, size_t size){
+    MMU_TIME_BEGIN(t);
+    lock_strategy(s);
+    Block *b = allocate_general(size);
+    MMU_TIME_END(malloc, t, size);
+    return b ? blk_to_ptr(b) : NULL;
+}
+
+void* malloc_first_fit(size_t size){ return malloc_general(STRAT_FIRST, size); }
+void* malloc_next_fit (size_t size){ return malloc_general(STRAT_NEXT,  size); }
+void* malloc_best_fit (size_t size){ return malloc_general(STRAT_BEST,  size); }
+void* malloc_worst_fit(size_t size){ return malloc_general(STRAT_WORST, size); }
+void* malloc_auto_fit (size_t size){ return malloc_general(STRAT_AUTO,  size); }
+
+MMU_HOT void free_general_as(Strategy s, int quick, void *ptr){
+    if (!ptr) return;
+    Block *b = ptr_to_blk(ptr);
+    if (b->head & (BLK_FREE|BLK_QUICK)) return;
+    if (s == STRAT_AUTO && g_auto) auto_note_free(blk_size(b));
+    if (s == STRAT_AUTO ? g_lazy_coalesce : quick){
+        size_t q = quick_bin(blk_size(b));
+        if (q < QUICK_BINS){
+            b->head |= BLK_QUICK;
+            b->next_free = g_quick[q];
+            g_quick[q] = b;
+            if (++g_quick_count > QUICK_LIMIT) quick_flush();
+            return;
+        }
+    }
+    b->head |= BLK_FREE;
+    coalesce_and_insert_as(s, b);
+}
+
+static void free_general(void *ptr){ free_general_as(STRAT_AUTO, 0, ptr); }
+
+// ======================= Specialised instances =======================
+// MMU_SPECIALIZE(name, strategy, quick) defines mmu_<name>_init/_malloc/_free
+// with the strategy and the quick-list mode (0/1) fixed at compile time, so
+// the index dispatch, the STRAT_AUTO bookkeeping and the lazy-coalescing test
+// fold away; free also skips the page map. Instances share the one general
+// heap: init locks the strategy (aborting on a mix, like the malloc_*
+// flavors) and sets the quick-list mode, and the hot path assumes both.
+// my_free, my_realloc and my_usable_size accept instance pointers.
+// MMU_INSTANCES lists the instances to define; define it before including
+// this header to choose others.
+#define MMU_SPECIALIZE(name, strategy, quick)                                   \
+    void mmu_##name##_init(void){                                               \
+        lock_strategy(strategy);                                                \
+        allocator_set_lazy_coalesce(quick);                                     \
+    }                                                                           \
+    void* mmu_##name##_malloc(size_t size){                                     \
+        assert(g_strat == (strategy) && g_lazy_coalesce == (quick));            \
+        MMU_TIME_BEGIN(t);                                                      \
+        Block *b = allocate_general_as(strategy, quick, size);                  \
+        MMU_TIME_END(malloc, t, size);                                          \
+        return b ? blk_to_ptr(b) : NULL;                                        \
+    }                                                                           \
+    void mmu_##name##_free(void *ptr){                                          \
+        assert(!ptr || pm_kind(pagemap_get(ptr)) == OWN_ARENA);                 \
+        MMU_TIME_BEGIN(t);                                                      \
+        free_general_as(strategy, quick, ptr);                                  \
+        MMU_TIME_END(free, t, (uintptr_t)ptr);                                  \
+    }
+
+#ifndef MMU_INSTANCES
+#define MMU_INSTANCES(X)                \
+    X(first,       STRAT_FIRST, 0)      \
+    X(next,        STRAT_NEXT,  0)      \
+    X(best,        STRAT_BEST,  0)      \
+    X(worst,       STRAT_WORST, 0)      \
+    X(first_quick, STRAT_FIRST, 1)      \
+    X(best_quick,  STRAT_BEST,  1)
+#endif
+MMU_INSTANCES(MMU_SPECIALIZE)
+
+// ======================= Buddy allocator (independent) =======================
+//
+// Safe for concurrent threads without a global lock. Free blocks of each order
+// sit on a lock-free stack whose links and states live in per-order side
+// tables, and every block changes hands through one atomic state transition.
+// Each thread owns the slab pages it carves and caches page-sized blocks, so
+// the common orders never touch shared state.
+
+static void *buddy_base=NULL; static size_t buddy_top_size=0;
+static size_t buddy_order0=0; static size_t buddy_pool_order=0;
+static uint64_t buddy_gen=0;    // bumped per pool; thread caches of an older pool are dropped
+
+// Block i of order o (offset i << o) has a stack link and a state byte in the
+// order's side tables, so a stale stack entry never aliases memory that has
+// been handed out again. `top` is (tag << 32) | (index + 1); the tag changes
+// on every push and pop, which makes the pop CAS immune to ABA.
+typedef struct BuddyBin {
+    uint64_t top;
+    uint32_t *next;             // index + 1 of the entry below, 0 = bottom
+    uint8_t *state;             // BIN_LINKED | BIN_FREE
+} __attribute__((aligned(CACHE_LINE))) BuddyBin;
+#define BIN_LINKED 1u           // index is on the order's stack (possibly stale)
+#define BIN_FREE   2u           // block is free at this order and may be taken
+static BuddyBin buddy_bins[BUDDY_MAX_ORDER+1];
+static void *buddy_side=NULL; static size_t buddy_side_len=0;
+
+// Out-of-band order map, one byte per minimum block (off >> buddy_order0).
+// Allocated block heads record their order; every other byte is 0. Blocks
+// carry no in-band tag, so a 2^k request gets a 2^k-aligned 2^k block.
+static uint8_t *buddy_map=NULL; static size_t buddy_map_len=0;
+#define BUDDY_ALLOC(o) ((uint8_t)((o)+1))
+
+static inline size_t order_size(size_t o){ return (size_t)1<<o; }
+static inline size_t ptr_off(void *p){ return (size_t)((uint8_t*)p - (uint8_t*)buddy_base); }
+static inline void* off_ptr(size_t off){ return (void*)((uint8_t*)buddy_base + off); }
+
+static inline void spin_lock(int *l){
+    for (unsigned n=0; __atomic_exchange_n(l,1,__ATOMIC_ACQUIRE); n++)
+        while (__atomic_load_n(l,__ATOMIC_RELAXED)) if (++n>64) sched_yield();
+}
+static inline void spin_unlock(int *l){ __atomic_store_n(l,0,__ATOMIC_RELEASE); }
+
+// Small-object front end: requests up to BUDDY_SMALL_MAX are served from
+// buddy pages carved into size-class slabs. The per-page descriptor lives out
+// of band, so slab objects carry no tag and pack at their class stride.
+#define BUDDY_SMALL_MAX 2048u
+static const uint16_t buddy_class_size[] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+    320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048
+};
+#define BUDDY_NCLASS (sizeof(buddy_class_size)/sizeof(buddy_class_size[0]))
+
+typedef struct BuddyHeap BuddyHeap;
+
+typedef struct BuddyPage {
+    struct BuddyPage *prev, *next;  // link in the owner's partial list for the class
+    void *free_list;
+    BuddyHeap *owner;               // heap that carved the page; fixed while objects are live
+    uint16_t cls;                   // size class + 1; 0 = page is not a slab
+    uint16_t used, bump, capacity;
+} BuddyPage;
+
+static BuddyPage *buddy_pages=NULL; static size_t buddy_npages=0;
+static uint8_t buddy_class_of[BUDDY_SMALL_MAX/ALIGN + 1];
+
+// Per-thread heap. Slab pages belong to the heap that carved them, and only
+// its thread allocates from them or frees into them, without any atomics.
+// A free from another thread is pushed onto the owner's remote queue, an
+// MPSC stack that the owner empties with one exchange when it runs short.
+// The heap also caches unmarked, unmerged blocks of orders BUDDY_PAGE_ORDER ..
+// BUDDY_PAGE_ORDER+BUDDY_TC_ORDERS-1. Heaps are never unmapped: the heap of
+// an exited thread is adopted by the next new thread, and its queue is
+// drained by whichever thread runs out of memory first.
+#define BUDDY_TC_ORDERS 5
+#define BUDDY_TC_DEPTH  8
+struct BuddyHeap {
+    void *remote;                   // objects freed by other threads, linked through the first word
+    struct BuddyHeap *link __attribute__((aligned(CACHE_LINE)));  // every heap, newest first
+    int in_use;                     // a thread owns the heap or is collecting it
+    uint64_t gen;                   // pool generation the heap's state refers to
+    BuddyPage *partial[BUDDY_NCLASS];
+    uint32_t nblk[BUDDY_TC_ORDERS];
+    uint32_t blk[BUDDY_TC_ORDERS][BUDDY_TC_DEPTH];  // offset >> BUDDY_PAGE_ORDER
+};
+static BuddyHeap *buddy_heaps=NULL;
+static __thread BuddyHeap *buddy_heap;
+static pthread_key_t buddy_heap_key; static pthread_once_t buddy_heap_once=PTHREAD_ONCE_INIT;
+
+static inline uint8_t* buddy_map_at(void *p){ return &buddy_map[ptr_off(p) >> buddy_order0]; }
+
+static void bin_push(size_t o, size_t i){
+    BuddyBin *bn=&buddy_bins[o];
+    uint64_t top=__atomic_load_n(&bn->top,__ATOMIC_ACQUIRE), nt;
+    do {
+        __atomic_store_n(&bn->next[i],(uint32_t)top,__ATOMIC_RELAXED);
+        nt=(((top>>32)+1)<<32) | (uint64_t)(i+1);
+    } while (!__atomic_compare_exchange_n(&bn->top,&top,nt,1,__ATOMIC_RELEASE,__ATOMIC_ACQUIRE));
+}
+
+static long bin_pop(size_t o){
+    BuddyBin *bn=&buddy_bins[o];
+    uint64_t top=__atomic_load_n(&bn->top,__ATOMIC_ACQUIRE);
+    while ((uint32_t)top){
+        size_t i=(uint32_t)top-1;
+        uint64_t nt=(((top>>32)+1)<<32) | __atomic_load_n(&bn->next[i],__ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&bn->top,&top,nt,1,__ATOMIC_ACQUIRE,__ATOMIC_ACQUIRE)) return (long)i;
+    }
+    return -1;
+}
+
+// Publish block i of order o as free. An index still linked from an earlier
+// life (claimed by a merge, not yet popped) is revived instead of pushed twice.
+static void bin_release(size_t o, size_t i){
+    if (!__atomic_exchange_n(&buddy_bins[o].state[i],(uint8_t)(BIN_LINKED|BIN_FREE),__ATOMIC_SEQ_CST))
+        bin_push(o,i);
+}
+
+// Take a free block for merging; its stack entry is left behind as stale.
+// The plain load keeps the common "buddy is busy" answer off the bus.
+static inline int bin_claim(size_t o, size_t i){
+    uint8_t s=BIN_LINKED|BIN_FREE;
+    return __atomic_load_n(&buddy_bins[o].state[i],__ATOMIC_SEQ_CST)==s
+        && __atomic_compare_exchange_n(&buddy_bins[o].state[i],&s,(uint8_t)BIN_LINKED,0,__ATOMIC_SEQ_CST,__ATOMIC_SEQ_CST);
+}
+
+// Pop a free block of order o, dropping entries whose block was merged away.
+static long bin_take(size_t o){
+    long i;
+    while ((i=bin_pop(o))>=0)
+        if (__atomic_exchange_n(&buddy_bins[o].state[i],(uint8_t)0,__ATOMIC_SEQ_CST) & BIN_FREE) return i;
+    return -1;
+}
+
+static inline void buddy_push(size_t o, void *p){ bin_release(o, ptr_off(p)>>o); }
+static inline void* buddy_pop(size_t o){ long i=bin_take(o); return i<0 ? NULL : off_ptr((size_t)i<<o); }
+
+static void buddy_init_pool(size_t min_bytes){
+    buddy_order0 = 0; while (order_size(buddy_order0) < ALIGN) buddy_order0++;
+    
+    buddy_pool_order = 22;
+    if (min_bytes > (size_t)(1<<22)){
+        size_t need = ALIGN_UP(min_bytes, order_size(buddy_order0));
+        buddy_pool_order = buddy_order0;
+        while (order_size(buddy_pool_order) < need && buddy_pool_order < BUDDY_MAX_ORDER) buddy_pool_order++;
+    }
+    
+    size_t total = order_size(buddy_pool_order);
+    void *mem = mmap(NULL,total,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+    if (mem==MAP_FAILED){ buddy_base=NULL; buddy_top_size=0; return; }
+
+    if (buddy_map) munmap(buddy_map, buddy_map_len);
+    buddy_map_len = total >> buddy_order0;
+    buddy_map = (uint8_t*)mmap(NULL,buddy_map_len,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+    if ((void*)buddy_map==MAP_FAILED){ munmap(mem,total); buddy_map=NULL; buddy_map_len=0; buddy_base=NULL; buddy_top_size=0; return; }
+
+    // Side tables: a uint32 link and a state byte per block of every order.
+    if (buddy_side) munmap(buddy_side, buddy_side_len);
+    buddy_side_len = 0;
+    for (size_t o=buddy_order0;o<=buddy_pool_order;o++) buddy_side_len += (total>>o)*(sizeof(uint32_t)+1);
+    buddy_side = mmap(NULL,buddy_side_len,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+    if (buddy_side==MAP_FAILED){ munmap(mem,total); buddy_side=NULL; buddy_side_len=0; buddy_base=NULL; buddy_top_size=0; return; }
+    uint8_t *side = (uint8_t*)buddy_side;
+    for (size_t o=0;o<=BUDDY_MAX_ORDER;o++){
+        buddy_bins[o].top=0; buddy_bins[o].next=NULL; buddy_bins[o].state=NULL;
+        if (o<buddy_order0 || o>buddy_pool_order) continue;
+        buddy_bins[o].next=(uint32_t*)side; side += (total>>o)*sizeof(uint32_t);
+    }
+    for (size_t o=buddy_order0;o<=buddy_pool_order;o++){ buddy_bins[o].state=side; side += total>>o; }
+
+    if (buddy_pages) munmap(buddy_pages, buddy_npages*sizeof(BuddyPage));
+    buddy_npages = total >> BUDDY_PAGE_ORDER;
+    buddy_pages = (BuddyPage*)mmap(NULL,buddy_npages*sizeof(BuddyPage),PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+    if ((void*)buddy_pages==MAP_FAILED){ munmap(mem,total); buddy_pages=NULL; buddy_npages=0; buddy_base=NULL; buddy_top_size=0; return; }
+    for (size_t q=1, c=0; q<=BUDDY_SMALL_MAX/ALIGN; q++){
+        while (buddy_class_size[c] < q*ALIGN || buddy_class_size[c] % ALIGN) c++;
+        buddy_class_of[q]=(uint8_t)c;
+    }
+
+    if (!pagemap_set(mem, total, OWN_BUDDY, mem)){ munmap(mem,total); buddy_base=NULL; buddy_top_size=0; return; }
+    buddy_top_size=total;
+    buddy_gen++;
+    bin_release(buddy_pool_order,0);
+    __atomic_store_n(&buddy_base,mem,__ATOMIC_RELEASE);
+}
+
+static int buddy_init_lock=0;
+
+static int buddy_ensure(size_t min_bytes){
+    if (__atomic_load_n(&buddy_base,__ATOMIC_ACQUIRE)) return 1;
+    spin_lock(&buddy_init_lock);
+    if (!buddy_base) buddy_init_pool(min_bytes);
+    spin_unlock(&buddy_init_lock);
+    return buddy_base!=NULL;
+}
+
+// Free a block of `order` at offset off, merging upward while the buddy can
+// be claimed. After publishing, the buddy is checked once more: a buddy freed
+// concurrently may have looked at us before we were free, and with both
+// transitions sequentially consistent at least one side sees the other.
+static void buddy_free_order(size_t o, size_t off){
+    MMU_TIME_BEGIN(t);
+    for (;;){
+        while (o<buddy_pool_order && bin_claim(o,(off>>o)^1)){ off &= ~order_size(o); o++; }
+        bin_release(o, off>>o);
+        if (o==buddy_pool_order || !bin_claim(o,(off>>o)^1)) break;
+        if (bin_claim(o, off>>o)){ off &= ~order_size(o); o++; continue; }
+        off ^= order_size(o);   // we were taken meanwhile; free the buddy on its own
+    }
+    MMU_TIME_END(buddy_merge, t, o);
+}
+
+// Smallest order whose block holds size bytes.
+static size_t buddy_order_for(size_t size){
+    size_t order = size > 1 ? (size_t)(64 - __builtin_clzll((unsigned long long)(size - 1))) : 0;
+    return order < buddy_order0 ? buddy_order0 : order;
+}
+
+static inline void* buddy_mark(void *p, size_t order){
+    __atomic_store_n(buddy_map_at(p),BUDDY_ALLOC(order),__ATOMIC_RELEASE);
+    return p;
+}
+static inline void buddy_unmark(void *p){ __atomic_store_n(buddy_map_at(p),(uint8_t)0,__ATOMIC_RELAXED); }
+
+// Pop the smallest free block of at least `order` and split it down. The
+// right halves need no merge attempt: their buddies are ours.
+static void* buddy_alloc_order(size_t order){
+    size_t k=order;
+    void *p=NULL;
+    while (k<=buddy_pool_order && !(p=buddy_pop(k))) k++;
+    if (!p) return NULL;
+
+    MMU_TIME_BEGIN(t);
+    while (k>order){
+        k--;
+        size_t half=order_size(k);
+        void *right=(void*)((uint8_t*)p+half);
+        buddy_push(k,right);
+    }
+    MMU_TIME_END(buddy_split, t, order);
+    return p;
+}
+
+static inline BuddyPage* buddy_page_of(void *p){ return &buddy_pages[ptr_off(p) >> BUDDY_PAGE_ORDER]; }
+static inline uint8_t* buddy_page_addr(BuddyPage *pg){ return (uint8_t*)off_ptr((size_t)(pg - buddy_pages) << BUDDY_PAGE_ORDER); }
+
+static void buddy_page_link(BuddyHeap *h, size_t c, BuddyPage *pg){
+    pg->prev=NULL; pg->next=h->partial[c];
+    if (pg->next) pg->next->prev=pg;
+    h->partial[c]=pg;
+}
+
+static void buddy_page_unlink(BuddyHeap *h, size_t c, BuddyPage *pg){
+    if (pg->prev) pg->prev->next=pg->next; else h->partial[c]=pg->next;
+    if (pg->next) pg->next->prev=pg->prev;
+    pg->prev=pg->next=NULL;
+}
+
+// Forget everything h knew about a replaced pool, without touching its memory.
+static void buddy_heap_reset(BuddyHeap *h){
+    __atomic_store_n(&h->remote,(void*)NULL,__ATOMIC_RELAXED);
+    memset(h->partial,0,sizeof h->partial);
+    memset(h->nblk,0,sizeof h->nblk);
+    h->gen=buddy_gen;
+}
+
+static void buddy_heap_exit(void *h);
+static void buddy_heap_key_init(void){ pthread_key_create(&buddy_heap_key, buddy_heap_exit); }
+
+static int buddy_heap_lock=0;   // serialises heap creation only
+static uint8_t *buddy_heap_chunk=NULL; static size_t buddy_heap_room=0;
+
+// Bind a heap to the calling thread: adopt one left by an exited thread, or
+// carve a new one.
+static BuddyHeap* buddy_heap_attach(void){
+    BuddyHeap *h;
+    for (h=__atomic_load_n(&buddy_heaps,__ATOMIC_ACQUIRE); h; h=h->link){
+        int idle=0;
+        if (__atomic_compare_exchange_n(&h->in_use,&idle,1,0,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED)) break;
+    }
+    if (!h){
+        spin_lock(&buddy_heap_lock);
+        if (buddy_heap_room<sizeof(BuddyHeap)){
+            void *m=mmap(NULL,64u<<10,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+            if (m==MAP_FAILED){ spin_unlock(&buddy_heap_lock); return NULL; }
+            buddy_heap_chunk=(uint8_t*)m; buddy_heap_room=64u<<10;
+        }
+        h=(BuddyHeap*)buddy_heap_chunk;
+        buddy_heap_chunk+=sizeof(BuddyHeap); buddy_heap_room-=sizeof(BuddyHeap);
+        h->in_use=1;
+        h->link=buddy_heaps;
+        __atomic_store_n(&buddy_heaps,h,__ATOMIC_RELEASE);
+        spin_unlock(&buddy_heap_lock);
+    }
+    pthread_once(&buddy_heap_once, buddy_heap_key_init);
+    pthread_setspecific(buddy_heap_key, h);
+    buddy_heap=h;
+    return h;
+}
+
+// The calling thread's heap, reset if it still refers to a replaced pool.
+static inline BuddyHeap* buddy_my_heap(void){
+    BuddyHeap *h=buddy_heap;
+    if (!h && !(h=buddy_heap_attach())) return NULL;
+    if (h->gen!=buddy_gen) buddy_heap_reset(h);
+    return h;
+}
+
+// Return an unmarked block: into h's cache if its order is cached and there
+// is room, otherwise merged into the shared bins.
+static void buddy_put(BuddyHeap *h, void *p, size_t order){
+    size_t t=order-BUDDY_PAGE_ORDER;
+    if (h && order>=BUDDY_PAGE_ORDER && t<BUDDY_TC_ORDERS && h->nblk[t]<BUDDY_TC_DEPTH){
+        h->blk[t][h->nblk[t]++]=(uint32_t)(ptr_off(p)>>BUDDY_PAGE_ORDER);
+        return;
+    }
+    buddy_free_order(order, ptr_off(p));
+}
+
+// Owner-side free of a slab object; an emptied page goes back as a buddy block.
+static void buddy_small_free_local(BuddyHeap *h, void *ptr){
+    BuddyPage *pg=buddy_page_of(ptr);
+    size_t c=pg->cls-1;
+    *(void**)ptr=pg->free_list;
+    pg->free_list=ptr;
+    if (pg->used--==pg->capacity) buddy_page_link(h,c,pg);
+    if (pg->used==0){
+        buddy_page_unlink(h,c,pg);
+        pg->cls=0; pg->owner=NULL;
+        void *a=buddy_page_addr(pg);
+        buddy_unmark(a);
+        buddy_put(h, a, BUDDY_PAGE_ORDER);
+    }
+}
+
+// Take everything other threads have freed to h and free it locally.
+static int buddy_heap_drain(BuddyHeap *h){
+    if (!__atomic_load_n(&h->remote,__ATOMIC_RELAXED)) return 0;
+    void *obj=__atomic_exchange_n(&h->remote,(void*)NULL,__ATOMIC_ACQUIRE);
+    while (obj){
+        void *next=*(void**)obj;
+        buddy_small_free_local(h,obj);
+        obj=next;
+    }
+    return 1;
+}
+
+// Drain h's remote queue and return its cached blocks to the bins; returns 0
+// if there was nothing to give back.
+static int buddy_heap_collect(BuddyHeap *h){
+    if (h->gen!=buddy_gen){ buddy_heap_reset(h); return 0; }
+    int any=buddy_heap_drain(h);
+    for (size_t t=0;t<BUDDY_TC_ORDERS;t++)
+        while (h->nblk[t]){
+            size_t off=(size_t)h->blk[t][--h->nblk[t]]<<BUDDY_PAGE_ORDER;
+            buddy_free_order(BUDDY_PAGE_ORDER+t, off);
+            any=1;
+        }
+    return any;
+}
+
+// Collect the heaps of exited threads; frees to them pile up in their queues.
+static int buddy_heap_reclaim(void){
+    int any=0;
+    for (BuddyHeap *h=__atomic_load_n(&buddy_heaps,__ATOMIC_ACQUIRE); h; h=h->link){
+        int idle=0;
+        if (!__atomic_compare_exchange_n(&h->in_use,&idle,1,0,__ATOMIC_ACQUIRE,__ATOMIC_RELAXED)) continue;
+        any|=buddy_heap_collect(h);
+        __atomic_store_n(&h->in_use,0,__ATOMIC_RELEASE);
+    }
+    return any;
+}
+
+static void buddy_heap_exit(void *p){
+    BuddyHeap *h=(BuddyHeap*)p;
+    buddy_heap_collect(h);
+    buddy_heap=NULL;
+    __atomic_store_n(&h->in_use,0,__ATOMIC_RELEASE);
+}
+
+// A block of `order` from h's cache, else from the bins. When the bins are
+// dry, exited threads' heaps and our own are collected (they may hold the
+// missing buddies) and the bins are tried once more.
+static void* buddy_get(BuddyHeap *h, size_t order){
+    size_t t=order-BUDDY_PAGE_ORDER;
+    if (h && order>=BUDDY_PAGE_ORDER && t<BUDDY_TC_ORDERS && h->nblk[t])
+        return off_ptr((size_t)h->blk[t][--h->nblk[t]]<<BUDDY_PAGE_ORDER);
+    void *p=buddy_alloc_order(order);
+    if (!p && (buddy_heap_reclaim() | (h && buddy_heap_collect(h)))) p=buddy_alloc_order(order);
+    return p;
+}
+
+// No page of class c has room: take back what other threads freed to us,
+// else carve a fresh page.
+static BuddyPage* buddy_small_refill(BuddyHeap *h, size_t c){
+    if (buddy_heap_drain(h) && h->partial[c]) return h->partial[c];
+    void *raw=buddy_get(h, BUDDY_PAGE_ORDER);
+    if (!raw) return h->partial[c];     // collecting may have refilled the class
+    buddy_mark(raw,BUDDY_PAGE_ORDER);
+    BuddyPage *pg=buddy_page_of(raw);
+    pg->owner=h;
+    pg->cls=(uint16_t)(c+1);
+    pg->used=pg->bump=0;
+    pg->capacity=(uint16_t)(order_size(BUDDY_PAGE_ORDER)/buddy_class_size[c]);
+    pg->free_list=NULL;
+    buddy_page_link(h,c,pg);
+    return pg;
+}
+
+static void* buddy_small_alloc(size_t size){
+    size_t c=buddy_class_of[size/ALIGN];
+    BuddyHeap *h=buddy_my_heap();
+    if (!h) return NULL;
+    BuddyPage *pg=h->partial[c];
+    if (!pg && !(pg=buddy_small_refill(h,c))) return NULL;
+
+    void *obj=pg->free_list;
+    if (obj) pg->free_list=*(void**)obj;
+    else obj=buddy_page_addr(pg) + (size_t)pg->bump++ * buddy_class_size[c];
+
+    if (++pg->used==pg->capacity) buddy_page_unlink(h,c,pg);
+    return obj;
+}
+
+// Returns 0 if ptr is not a slab object. The owning thread frees in place;
+// any other thread pushes the object onto the owner's remote queue.
+static int buddy_small_free(void *ptr){
+    BuddyPage *pg=buddy_page_of(ptr);
+    if (!pg->cls) return 0;
+    BuddyHeap *o=pg->owner;
+    if (o==buddy_heap){ buddy_small_free_local(o,ptr); return 1; }
+    void *head=__atomic_load_n(&o->remote,__ATOMIC_RELAXED);
+    do *(void**)ptr=head;
+    while (!__atomic_compare_exchange_n(&o->remote,&head,ptr,1,__ATOMIC_RELEASE,__ATOMIC_RELAXED));
+    return 1;
+}
+
+static void* buddy_alloc(size_t size){
+    if (size==0) return NULL;
+    size=ALIGN_UP(size,ALIGN);
+    if (!buddy_ensure(size)) return NULL;
+
+    if (size<=BUDDY_SMALL_MAX) return buddy_small_alloc(size);
+
+    size_t order=buddy_order_for(size);
+    if (order>buddy_pool_order) return NULL;
+
+    void *p=buddy_get(buddy_my_heap(), order);
+    return p ? buddy_mark(p, order) : NULL;
+}
+
+void* malloc_buddy_alloc(size_t size){
+    MMU_TIME_BEGIN(t);
+    void *p = buddy_alloc(size);
+    MMU_TIME_END(buddy_alloc, t, size);
+    return p;
+}
+
+// Ownership is decided by address range; the order comes from the side table.
+static int is_buddy_ptr(void *ptr, size_t *out_order, void **out_raw){
+    if (!buddy_base) return 0;
+    uintptr_t a=(uintptr_t)ptr;
+    uintptr_t L=(uintptr_t)buddy_base;
+    uintptr_t R=L+buddy_top_size;
+    if (a<L || a>=R || ((a-L) & (order_size(buddy_order0)-1))) return 0;
+    uint8_t m=__atomic_load_n(buddy_map_at(ptr),__ATOMIC_ACQUIRE);
+    if (!m) return 0;
+    if (out_order) *out_order=(size_t)m-1;
+    if (out_raw) *out_raw=ptr;
+    return 1;
+}
+
+// Free a pointer known to lie inside the buddy pool. Clearing the order byte
+// is a CAS, so of two racing frees of one block only one gets to release it.
+static void buddy_free(void *ptr){
+    size_t ord;
+    if (buddy_small_free(ptr)) return;
+    if (!is_buddy_ptr(ptr, &ord, NULL)) return;
+    uint8_t m=BUDDY_ALLOC(ord);
+    if (__atomic_compare_exchange_n(buddy_map_at(ptr),&m,(uint8_t)0,0,__ATOMIC_ACQ_REL,__ATOMIC_RELAXED))
+        buddy_put(buddy_my_heap(), ptr, ord);
+}
+
+// ======================= Object pools (fixed-size slabs) =======================
+
+typedef struct MmuPool MmuPool;
+
+typedef struct PoolSlab {
+    struct PoolSlab *prev, *next;   // link in the pool's partial or full list
+    MmuPool *pool;
+    void *free_list;                // intrusive list threaded through freed objects
+    uint8_t *bump;                  // first never-used object
+    uint8_t *end;
+    uint32_t used, capacity;
+} PoolSlab;
+
+struct MmuPool {
+    size_t obj_size, align;
+    PoolSlab *partial;              // slabs with at least one free object
+    PoolSlab *full;
+    PoolSlab *spare;                // one empty slab kept to damp map/unmap churn
+    size_t colour, colour_step;
+};
+
+// Slabs are POOL_SLAB_SIZE-aligned so an object finds its slab header by masking.
+static void* map_aligned(size_t size, size_t align){
+    size_t span = size + align;
+    uint8_t *mem = (uint8_t*)mmap(NULL, span, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if ((void*)mem == MAP_FAILED) return NULL;
+    uint8_t *p = (uint8_t*)ALIGN_UP((uintptr_t)mem, (uintptr_t)align);
+    if (p > mem) munmap(mem, (size_t)(p - mem));
+    if (p + size < mem + span) munmap(p + size, (size_t)(mem + span - (p + size)));
+    return p;
+}
+
+static inline PoolSlab* pool_slab_of(void *obj){
+    return (PoolSlab*)((uintptr_t)obj & ~((uintptr_t)POOL_SLAB_SIZE - 1));
+}
+
+static void slab_link(PoolSlab **head, PoolSlab *s){
+    s->prev = NULL; s->next = *head;
+    if (*head) (*head)->prev = s;
+    *head = s;
+}
+
+static void slab_unlink(PoolSlab **head, PoolSlab *s){
+    if (s->prev) s->prev->next = s->next; else *head = s->next;
+    if (s->next) s->next->prev = s->prev;
+    s->prev = s->next = NULL;
+}
+
+static PoolSlab* pool_new_slab(MmuPool *pool){
+    PoolSlab *s = pool->spare;
+    if (s) pool->spare = NULL;
+    else {
+        s = (PoolSlab*)map_aligned(POOL_SLAB_SIZE, POOL_SLAB_SIZE);
+        if (!s) return NULL;
+        if (!pagemap_set(s, POOL_SLAB_SIZE, OWN_POOL, s)){ munmap(s, POOL_SLAB_SIZE); return NULL; }
+    }
+    // Cache colouring: successive slabs start their objects at different
+    // cache-line offsets so hot objects of different slabs do not alias.
+    size_t first = ALIGN_UP(sizeof(PoolSlab), pool->align) + pool->colour;
+    s->pool = pool;
+    s->free_list = NULL;
+    s->bump = (uint8_t*)s + first;
+    s->end = (uint8_t*)s + POOL_SLAB_SIZE;
+    s->used = 0;
+    s->capacity = (uint32_t)((POOL_SLAB_SIZE - first) / pool->obj_size);
+    size_t slack = POOL_SLAB_SIZE - ALIGN_UP(sizeof(PoolSlab), pool->align) - (size_t)s->capacity * pool->obj_size;
+    pool->colour += pool->colour_step;
+    if (pool->colour > slack) pool->colour = 0;
+    return s;
+}
+
+static void pool_unmap_slab(PoolSlab *s){
+    pagemap_set(s, POOL_SLAB_SIZE, OWN_NONE, NULL);
+    munmap(s, POOL_SLAB_SIZE);
+}
+
+static void pool_release_slab(MmuPool *pool, PoolSlab *s){
+    if (!pool->spare) pool->spare = s;
+    else pool_unmap_slab(s);
+}
+
+// Pool descriptors are themselves carved from a bootstrap pool.
+static MmuPool g_pool_of_pools = { ALIGN_UP(sizeof(MmuPool), sizeof(void*)), sizeof(void*), NULL, NULL, NULL, 0, CACHE_LINE };
+
+void* mmu_pool_alloc(MmuPool *pool);
+void mmu_pool_free(MmuPool *pool, void *obj);
+
+MmuPool* mmu_pool_create(size_t obj_size, size_t align){
+    if (align == 0) align = ALIGN;
+    if (align & (align - 1)) return NULL;
+    if (obj_size < sizeof(void*)) obj_size = sizeof(void*);
+    obj_size = ALIGN_UP(obj_size, align);
+    if (obj_size > POOL_SLAB_SIZE / 8 || align > POOL_SLAB_SIZE / 8) return NULL;
+
+    MmuPool *pool = (MmuPool*)mmu_pool_alloc(&g_pool_of_pools);
+    if (!pool) return NULL;
+    memset(pool, 0, sizeof(*pool));
+    pool->obj_size = obj_size;
+    pool->align = align;
+    pool->colour_step = align > CACHE_LINE ? align : CACHE_LINE;
+    return pool;
+}
+
+static void* pool_alloc(MmuPool *pool){
+    PoolSlab *s = pool->partial;
+    if (!s){
+        s = pool_new_slab(pool);
+        if (!s) return NULL;
+        slab_link(&pool->partial, s);
+    }
+
+    void *obj = s->free_list;
+    if (obj) s->free_list = *(void**)obj;
+    else { obj = s->bump; s->bump += pool->obj_size; }
+
+    if (++s->used == s->capacity){
+        slab_unlink(&pool->partial, s);
+        slab_link(&pool->full, s);
+    }
+    return obj;
+}
+
+void* mmu_pool_alloc(MmuPool *pool){
+    MMU_TIME_BEGIN(t);
+    void *p = pool_alloc(pool);
+    MMU_TIME_END(pool_alloc, t, pool->obj_size);
+    return p;
+}
+
+void mmu_pool_free(MmuPool *pool, void *obj){
+    if (!obj) return;
+    MMU_TIME_BEGIN(t);
+    PoolSlab *s = pool_slab_of(obj);
+    assert(s->pool == pool);
+
+    *(void**)obj = s->free_list;
+    s->free_list = obj;
+
+    if (s->used-- == s->capacity){
+        slab_unlink(&pool->full, s);
+        slab_link(&pool->partial, s);
+    }
+    if (s->used == 0){
+        slab_unlink(&pool->partial, s);
+        pool_release_slab(pool, s);
+    }
+    MMU_TIME_END(pool_free, t, pool->obj_size);
+}
+
+void mmu_pool_destroy(MmuPool *pool){
+    if (!pool) return;
+    PoolSlab *lists[2] = { pool->partial, pool->full };
+    for (int i = 0; i < 2; i++){
+        PoolSlab *s = lists[i];
+        while (s){ PoolSlab *n = s->next; pool_unmap_slab(s); s = n; }
+    }
+    if (pool->spare) pool_unmap_slab(pool->spare);
+    mmu_pool_free(&g_pool_of_pools, pool);
+}
+
+// ======================= Regions (bump allocation, bulk reset) =======================
+
+#ifndef REGION_CHUNK_MIN
+#define REGION_CHUNK_MIN (64u<<10)
+#endif
+
+// Chunk header: only what bump allocation and reset need, so a chunk does
+// not spend an Arena's worth of free-list state on its first bytes.
+typedef struct RegionChunk {
+    struct RegionChunk *next;
+    size_t size;            // mapped bytes, header included
+    uint8_t *bump;          // next free byte
+} RegionChunk;
+#define REGION_HDR_SZ ALIGN_UP(sizeof(RegionChunk), ALIGN)
+
+typedef struct MmuRegion {
+    RegionChunk *chunks;    // newest first; the head chunk is the bump target
+    size_t chunk_size;
+    int keep_warm;          // keep one chunk mapped across resets
+} MmuRegion;
+
+static MmuPool *g_region_descs = NULL;
+
+MmuRegion* mmu_region_create(size_t chunk_size, int keep_warm){
+    if (!g_region_descs) g_region_descs = mmu_pool_create(sizeof(MmuRegion), 0);
+    if (!g_region_descs) return NULL;
+    MmuRegion *r = (MmuRegion*)mmu_pool_alloc(g_region_descs);
+    if (!r) return NULL;
+    if (chunk_size < REGION_CHUNK_MIN) chunk_size = REGION_CHUNK_MIN;
+    r->chunks = NULL;
+    r->chunk_size = ALIGN_UP(chunk_size, ALIGN);
+    r->keep_warm = keep_warm;
+    return r;
+}
+
+static int region_grow(MmuRegion *r, size_t size){
+    size_t bytes = REGION_HDR_SZ + size;
+    if (bytes < r->chunk_size) bytes = r->chunk_size;
+    void *mem = mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return 0;
+    if (!pagemap_set(mem, bytes, OWN_REGION, r)){ munmap(mem, bytes); return 0; }
+    RegionChunk *c = (RegionChunk*)mem;
+    c->next = r->chunks;
+    c->size = bytes;
+    c->bump = (uint8_t*)c + REGION_HDR_SZ;
+    r->chunks = c;
+    return 1;
+}
+
+static void* region_alloc(MmuRegion *r, size_t size){
+    if (size == 0) return NULL;
+    size = ALIGN_UP(size, ALIGN);
+    RegionChunk *c = r->chunks;
+    if (!c || (size_t)((uint8_t*)c + c->size - c->bump) < size){
+        if (!region_grow(r, size)) return NULL;
+        c = r->chunks;
+    }
+    void *p = c->bump;
+    c->bump += size;
+    return p;
+}
+
+void* mmu_region_alloc(MmuRegion *r, size_t size){
+    MMU_TIME_BEGIN(t);
+    void *p = region_alloc(r, size);
+    MMU_TIME_END(region_alloc, t, size);
+    return p;
+}
+
+// Release every allocation at once: O(chunks), no per-object work.
+void mmu_region_reset(MmuRegion *r){
+    RegionChunk *keep = NULL, *c = r->chunks;
+    while (c){
+        RegionChunk *next = c->next;
+        if (r->keep_warm && !keep && c->size == r->chunk_size) keep = c;
+        else { pagemap_set(c, c->size, OWN_NONE, NULL); munmap(c, c->size); }
+        c = next;
+    }
+    r->chunks = keep;
+    if (keep){
+        keep->next = NULL;
+        keep->bump = (uint8_t*)keep + REGION_HDR_SZ;
+    }
+}
+
+void mmu_region_destroy(MmuRegion *r){
+    if (!r) return;
+    r->keep_warm = 0;
+    mmu_region_reset(r);
+    mmu_pool_free(g_region_descs, r);
+}
+
+// ======================= Persistent heap (file-backed) =======================
+// A self-contained first-fit heap living entirely inside a MAP_SHARED file:
+// header, boundary-tagged blocks, the address-ordered free list and a root
+// object. The file is always mapped at the base address recorded when it
+// was created, so raw pointers stored in objects stay valid across runs;
+// the heap's own links are offsets, so the checker can map it anywhere.
+// The same layout backs the process-shared heap (memfd) further down.
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+#define PHEAP_MAGIC   0x5041454850554d4dull   // "MMUPHEAP"
+#define PHEAP_VERSION 2u
+
+typedef struct MmuPHeap {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t clean;             // 1 once closed cleanly, 0 while open
+    uint64_t base, size;        // recorded mapping address and file length
+    uint64_t root;              // offset of the root object, 0 if unset
+    uint64_t free_head;         // offset of the first free block, 0 if none
+    uint32_t shared;            // process-shared: every operation takes lock
+    uint32_t recoveries;        // lock owners found dead and recovered from
+    pthread_mutex_t lock;       // robust, process-shared; used only if shared
+} MmuPHeap;
+
+// Blocks reuse the general heap's boundary-tag layout with offset links.
+typedef struct PBlock {
+    uint64_t prev_size;         // payload size of the physical predecessor, 0 if first
+    uint64_t head;              // payload size | BLK_FREE | BLK_LAST
+    uint64_t next_off, prev_off;
+} PBlock;
+
+#define PH_DATA_OFF ALIGN_UP(sizeof(MmuPHeap), CACHE_LINE)
+#define PH_MIN_PAYLOAD ALIGN_UP(sizeof(PBlock) - HDR_SZ, ALIGN)
+
+static inline PBlock* ph_at(MmuPHeap *h, uint64_t off){ return (PBlock*)((uint8_t*)h + off); }
+static inline uint64_t ph_off(MmuPHeap *h, PBlock *b){ return (uint64_t)((uint8_t*)b - (uint8_t*)h); }
+static inline uint64_t ph_size(PBlock *b){ return b->head & ~(uint64_t)BLK_FLAGS; }
+static inline PBlock* ph_next_phys(PBlock *b){
+    return (b->head & BLK_LAST) ? NULL : (PBlock*)((uint8_t*)b + HDR_SZ + ph_size(b));
+}
+static inline PBlock* ph_prev_phys(PBlock *b){
+    return b->prev_size ? (PBlock*)((uint8_t*)b - HDR_SZ - b->prev_size) : NULL;
+}
+static inline void ph_sync_next(PBlock *b){
+    PBlock *n = ph_next_phys(b);
+    if (n) n->prev_size = ph_size(b);
+}
+
+static void ph_unlink(MmuPHeap *h, PBlock *b){
+    if (b->prev_off) ph_at(h, b->prev_off)->next_off = b->next_off; else h->free_head = b->next_off;
+    if (b->next_off) ph_at(h, b->next_off)->prev_off = b->prev_off;
+}
+
+// Put b where old sits in the free list (same neighbours, so order holds).
+static void ph_replace(MmuPHeap *h, PBlock *old, PBlock *b){
+    uint64_t off = ph_off(h, b);
+    b->next_off = old->next_off;
+    b->prev_off = old->prev_off;
+    if (b->prev_off) ph_at(h, b->prev_off)->next_off = off; else h->free_head = off;
+    if (b->next_off) ph_at(h, b->next_off)->prev_off = off;
+}
+
+static void ph_insert_sorted(MmuPHeap *h, PBlock *b){
+    uint64_t off = ph_off(h, b), prev = 0, next = h->free_head;
+    while (next && next < off){ prev = next; next = ph_at(h, next)->next_off; }
+    b->prev_off = prev;
+    b->next_off = next;
+    if (prev) ph_at(h, prev)->next_off = off; else h->free_head = off;
+    if (next) ph_at(h, next)->prev_off = off;
+}
+
+// Consistency check over a mapped heap: physical walk (tags, sizes, no two
+// free neighbours), free-list walk (order, links, flags) and the root.
+// Returns the number of problems found; verbose reports them on stderr.
+static size_t ph_check(MmuPHeap *h, size_t len, int verbose){
+    size_t bad = 0, nfree_phys = 0, nfree_list = 0;
+#define PH_BAD(...) do { bad++; if (verbose) fprintf(stderr, "[pheap] " __VA_ARGS__); } while (0)
+    if (h->magic != PHEAP_MAGIC || h->version != PHEAP_VERSION){ PH_BAD("bad magic/version\n"); return bad; }
+    if (h->size != len || len < PH_DATA_OFF + HDR_SZ + PH_MIN_PAYLOAD){ PH_BAD("size %llu does not match file length %zu\n", (unsigned long long)h->size, len); return bad; }
+
+    uint64_t off = PH_DATA_OFF, prev_size = 0;
+    int prev_free = 0, root_ok = h->root == 0;
+    for (;;){
+        PBlock *b = ph_at(h, off);
+        uint64_t sz = ph_size(b);
+        if (b->prev_size != prev_size) PH_BAD("block %llu: prev_size %llu, expected %llu\n", (unsigned long long)off, (unsigned long long)b->prev_size, (unsigned long long)prev_size);
+        if (sz < PH_MIN_PAYLOAD || off + HDR_SZ + sz > len){ PH_BAD("block %llu: size %llu out of bounds\n", (unsigned long long)off, (unsigned long long)sz); return bad; }
+        int is_free = (b->head & BLK_FREE) != 0;
+        if (is_free && prev_free) PH_BAD("block %llu: adjacent free blocks not coalesced\n", (unsigned long long)off);
+        if (!is_free && h->root == off + HDR_SZ) root_ok = 1;
+        nfree_phys += is_free;
+        prev_free = is_free;
+        prev_size = sz;
+        off += HDR_SZ + sz;
+        if (b->head & BLK_LAST){
+            if (off != len) PH_BAD("last block ends at %llu, file is %zu bytes\n", (unsigned long long)off, len);
+            break;
+        }
+        if (off >= len){ PH_BAD("no block marked last\n"); break; }
+    }
+    if (!root_ok) PH_BAD("root %llu is not an allocated block\n", (unsigned long long)h->root);
+
+    uint64_t prev = 0;
+    for (uint64_t f = h->free_head; f; f = ph_at(h, f)->next_off){
+        if (f <= prev || f < PH_DATA_OFF || f >= len || (f - PH_DATA_OFF) % ALIGN){ PH_BAD("free list: bad link %llu\n", (unsigned long long)f); break; }
+        PBlock *b = ph_at(h, f);
+        if (!(b->head & BLK_FREE)) PH_BAD("free list: block %llu not marked free\n", (unsigned long long)f);
+        if (b->prev_off != prev) PH_BAD("free list: block %llu has prev %llu, expected %llu\n", (unsigned long long)f, (unsigned long long)b->prev_off, (unsigned long long)prev);
+        if (++nfree_list > nfree_phys) break;
+        prev = f;
+    }
+    if (nfree_list != nfree_phys) PH_BAD("free list holds %zu blocks, heap has %zu free\n", nfree_list, nfree_phys);
+#undef PH_BAD
+    return bad;
+}
+
+static void ph_format(MmuPHeap *h, size_t size, int shared){
+    h->magic = PHEAP_MAGIC;
+    h->version = PHEAP_VERSION;
+    h->base = (uint64_t)(uintptr_t)h;
+    h->size = size;
+    h->root = 0;
+    h->shared = (uint32_t)shared;
+    h->recoveries = 0;
+    PBlock *b = ph_at(h, PH_DATA_OFF);
+    b->prev_size = 0;
+    b->head = (size - PH_DATA_OFF - HDR_SZ) | BLK_FREE | BLK_LAST;
+    b->next_off = b->prev_off = 0;
+    h->free_head = PH_DATA_OFF;
+    if (shared){
+        pthread_mutexattr_t ma;
+        pthread_mutexattr_init(&ma);
+        pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&ma, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&h->lock, &ma);
+        pthread_mutexattr_destroy(&ma);
+    }
+}
+
+// Rebuild the free list from a physical walk, merging free neighbours. Used
+// when a lock owner died mid-operation and the list may be half-updated;
+// the boundary tags are written so that the walk always sees whole blocks.
+static int ph_rebuild(MmuPHeap *h){
+    uint64_t off = PH_DATA_OFF, prev_free = 0, tail = 0, prev_size = 0;
+    h->free_head = 0;
+    for (;;){
+        PBlock *b = ph_at(h, off);
+        uint64_t sz = ph_size(b);
+        if (sz < PH_MIN_PAYLOAD || off + HDR_SZ + sz > h->size) return 0;
+        b->prev_size = prev_size;
+        if ((b->head & BLK_FREE) && prev_free){
+            PBlock *L = ph_at(h, prev_free);
+            L->head = (ph_size(L) + HDR_SZ + sz) | BLK_FREE | (b->head & BLK_LAST);
+            b = L;
+        } else if (b->head & BLK_FREE){
+            b->prev_off = tail;
+            b->next_off = 0;
+            if (tail) ph_at(h, tail)->next_off = off; else h->free_head = off;
+            tail = prev_free = off;
+        } else {
+            prev_free = 0;
+        }
+        prev_size = ph_size(b);
+        if (b->head & BLK_LAST) return 1;
+        off = ph_off(h, b) + HDR_SZ + ph_size(b);
+    }
+}
+
+static int ph_lock(MmuPHeap *h){
+    if (!h->shared) return 1;
+    int rc = pthread_mutex_lock(&h->lock);
+    if (rc == EOWNERDEAD){
+        h->recoveries++;
+        if (!ph_rebuild(h)){ pthread_mutex_unlock(&h->lock); return 0; }
+        pthread_mutex_consistent(&h->lock);
+        rc = 0;
+    }
+    return rc == 0;
+}
+
+static inline void ph_unlock(MmuPHeap *h){ if (h->shared) pthread_mutex_unlock(&h->lock); }
+
+// Open the heap in path, creating it with `size` bytes if the file is empty
+// or missing. A new heap is mapped at base (or where the kernel chooses if
+// NULL); an existing one only at its recorded base. A heap that was not
+// closed cleanly is checked first and refused (errno EIO) if inconsistent.
+MmuPHeap* mmu_pheap_open(const char *path, size_t size, void *base){
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) return NULL;
+    struct stat st;
+    MmuPHeap *h = NULL;
+    int created = 0;
+    if (fstat(fd, &st) != 0) goto out;
+
+    if (st.st_size == 0){
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size = ALIGN_UP(size, page);
+        if (size < PH_DATA_OFF + HDR_SZ + PH_MIN_PAYLOAD || ftruncate(fd, (off_t)size) != 0) goto out;
+        created = 1;
+    } else {
+        MmuPHeap hdr;
+        if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) || hdr.magic != PHEAP_MAGIC
+            || hdr.size != (uint64_t)st.st_size){ errno = EINVAL; goto out; }
+        size = (size_t)hdr.size;
+        base = (void*)(uintptr_t)hdr.base;
+    }
+
+    h = (MmuPHeap*)mmap(base, size, PROT_READ|PROT_WRITE, MAP_SHARED | (base ? MAP_FIXED_NOREPLACE : 0), fd, 0);
+    if ((void*)h == MAP_FAILED){ h = NULL; goto out; }
+    if (base && (void*)h != base){ munmap(h, size); h = NULL; errno = EEXIST; goto out; }
+
+    if (created) ph_format(h, size, 0);
+    else if (!h->clean && ph_check(h, size, 1)){
+        munmap(h, size); h = NULL; errno = EIO; goto out;
+    }
+    if (!pagemap_set(h, size, OWN_PHEAP, h)){ munmap(h, size); h = NULL; goto out; }
+    h->clean = 0;
+out:
+    close(fd);
+    return h;
+}
+
+static void* ph_alloc(MmuPHeap *h, size_t size){
+
+    uint64_t f = h->free_head;
+    while (f && ph_size(ph_at(h, f)) < size) f = ph_at(h, f)->next_off;
+    if (!f) return NULL;
+
+    PBlock *b = ph_at(h, f);
+    uint64_t left = ph_size(b) - size;
+    if (left >= HDR_SZ + PH_MIN_PAYLOAD){
+        PBlock *rem = (PBlock*)((uint8_t*)b + HDR_SZ + size);
+        rem->prev_size = size;
+        rem->head = (left - HDR_SZ) | BLK_FREE | (b->head & BLK_LAST);
+        ph_sync_next(rem);
+        ph_replace(h, b, rem);
+        b->head = size;
+    } else {
+        ph_unlink(h, b);
+        b->head &= ~(uint64_t)BLK_FREE;
+    }
+    return (uint8_t*)b + HDR_SZ;
+}
+
+static void ph_free(MmuPHeap *h, PBlock *b){
+    if (b->head & BLK_FREE) return;
+    PBlock *L = ph_prev_phys(b), *R = ph_next_phys(b);
+    int lfree = L && (L->head & BLK_FREE), rfree = R && (R->head & BLK_FREE);
+
+    if (lfree){
+        // L keeps its place in the list; R, if free, is absorbed and unlinked.
+        uint64_t sz = ph_size(L) + HDR_SZ + ph_size(b);
+        uint64_t last = b->head & BLK_LAST;
+        if (rfree){ ph_unlink(h, R); sz += HDR_SZ + ph_size(R); last = R->head & BLK_LAST; }
+        L->head = sz | BLK_FREE | last;
+        ph_sync_next(L);
+    } else if (rfree){
+        b->head = (ph_size(b) + HDR_SZ + ph_size(R)) | BLK_FREE | (R->head & BLK_LAST);
+        ph_sync_next(b);
+        ph_replace(h, R, b);
+    } else {
+        b->head |= BLK_FREE;
+        ph_insert_sorted(h, b);
+    }
+}
+
+void* mmu_pheap_alloc(MmuPHeap *h, size_t size){
+    if (size == 0) return NULL;
+    size = ALIGN_UP(size, ALIGN);
+    if (size < PH_MIN_PAYLOAD) size = PH_MIN_PAYLOAD;
+    if (!ph_lock(h)) return NULL;
+    void *p = ph_alloc(h, size);
+    ph_unlock(h);
+    return p;
+}
+
+void mmu_pheap_free(MmuPHeap *h, void *ptr){
+    if (!ptr || !ph_lock(h)) return;
+    ph_free(h, (PBlock*)((uint8_t*)ptr - HDR_SZ));
+    ph_unlock(h);
+}
+
+// Offsets name objects independently of where each process mapped the heap.
+static inline uint64_t mmu_pheap_off(MmuPHeap *h, void *obj){ return obj ? (uint64_t)((uint8_t*)obj - (uint8_t*)h) : 0; }
+static inline void* mmu_pheap_ptr(MmuPHeap *h, uint64_t off){ return off ? (uint8_t*)h + off : NULL; }
+
+void mmu_pheap_set_root(MmuPHeap *h, void *obj){
+    h->root = obj ? (uint64_t)((uint8_t*)obj - (uint8_t*)h) : 0;
+}
+
+void* mmu_pheap_root(MmuPHeap *h){
+    return h->root ? (uint8_t*)h + h->root : NULL;
+}
+
+// Flush to the file without marking the heap clean.
+int mmu_pheap_sync(MmuPHeap *h){
+    return msync(h, (size_t)h->size, MS_SYNC);
+}
+
+int mmu_pheap_close(MmuPHeap *h){
+    size_t size = (size_t)h->size;
+    h->clean = 1;
+    int rc = msync(h, size, MS_SYNC);
+    pagemap_set(h, size, OWN_NONE, NULL);
+    if (munmap(h, size) != 0) rc = -1;
+    return rc;
+}
+
+// ======================= Shared heap (memfd, multi-process) =======================
+// The persistent heap layout on an anonymous memfd. Each process may map it
+// at a different address, so objects are named by offset (mmu_pheap_off /
+// mmu_pheap_ptr) when handed between processes. A robust process-shared
+// mutex serialises alloc/free; if its owner dies, the next locker rebuilds
+// the free list from the boundary tags and carries on.
+
+// Create a shared heap of `size` bytes; *fd_out receives the memfd, which
+// forked children inherit and other processes can receive over a socket.
+MmuPHeap* mmu_shheap_create(size_t size, int *fd_out){
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size = ALIGN_UP(size, page);
+    if (size < PH_DATA_OFF + HDR_SZ + PH_MIN_PAYLOAD) return NULL;
+    // Raw syscall: translation units that include libc headers before this
+    // one (without _GNU_SOURCE) do not see the memfd_create() prototype.
+    int fd = (int)syscall(SYS_memfd_create, "mmu_shheap", 1u /* MFD_CLOEXEC */);
+    if (fd < 0) return NULL;
+    if (ftruncate(fd, (off_t)size) != 0){ close(fd); return NULL; }
+    MmuPHeap *h = (MmuPHeap*)mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if ((void*)h == MAP_FAILED){ close(fd); return NULL; }
+    ph_format(h, size, 1);
+    if (!pagemap_set(h, size, OWN_PHEAP, h)){ munmap(h, size); close(fd); return NULL; }
+    if (fd_out) *fd_out = fd; else close(fd);
+    return h;
+}
+
+// Map a shared heap received as a memfd, at whatever address is free.
+MmuPHeap* mmu_shheap_attach(int fd){
+    MmuPHeap hdr;
+    if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) || hdr.magic != PHEAP_MAGIC || !hdr.shared){ errno = EINVAL; return NULL; }
+    MmuPHeap *h = (MmuPHeap*)mmap(NULL, (size_t)hdr.size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if ((void*)h == MAP_FAILED) return NULL;
+    if (!pagemap_set(h, (size_t)hdr.size, OWN_PHEAP, h)){ munmap(h, (size_t)hdr.size); return NULL; }
+    return h;
+}
+
+void mmu_shheap_detach(MmuPHeap *h){
+    size_t size = (size_t)h->size;
+    pagemap_set(h, size, OWN_NONE, NULL);
+    munmap(h, size);
+}
+
+// Offline checker: maps the file read-only at any address and validates it.
+// Returns the number of problems (0 = consistent), or -1 if it cannot be read.
+long mmu_pheap_check(const char *path, int verbose){
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MmuPHeap)){ close(fd); return -1; }
+    void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return -1;
+    MmuPHeap *h = (MmuPHeap*)m;
+    long bad = (long)ph_check(h, (size_t)st.st_size, verbose);
+    if (verbose && !bad && !h->clean) fprintf(stderr, "[pheap] %s: not closed cleanly, but consistent\n", path);
+    munmap(m, (size_t)st.st_size);
+    return bad;
+}
+
+// ======================= Unified free =======================
+
+// Region memory is released in bulk and pointers no heap owns are ignored.
+void my_free(void *ptr){
+    if (!ptr) return;
+    MMU_TIME_BEGIN(t);
+    uintptr_t own = owner_of(ptr);
+    switch (pm_kind(own)){
+    case OWN_ARENA: free_general(ptr); break;
+    case OWN_BUDDY: buddy_free(ptr); break;
+    case OWN_POOL:  mmu_pool_free(((PoolSlab*)pm_owner(own))->pool, ptr); break;
+    case OWN_PHEAP: mmu_pheap_free((MmuPHeap*)pm_owner(own), ptr); break;
+    default: break;
+    }
+    MMU_TIME_END(free, t, (uintptr_t)ptr);
+}
+
+// Bytes usable at ptr; 0 for region memory and pointers no heap owns.
+size_t my_usable_size(void *ptr){
+    if (!ptr) return 0;
+    uintptr_t own = owner_of(ptr);
+    size_t ord;
+    switch (pm_kind(own)){
+    case OWN_ARENA: return blk_size(ptr_to_blk(ptr));
+    case OWN_BUDDY: {
+        BuddyPage *pg = buddy_page_of(ptr);
+        if (pg->cls) return buddy_class_size[pg->cls - 1];
+        return is_buddy_ptr(ptr, &ord, NULL) ? order_size(ord) : 0;
+    }
+    case OWN_POOL:  return ((PoolSlab*)pm_owner(own))->pool->obj_size;
+    case OWN_PHEAP: return (size_t)ph_size((PBlock*)((uint8_t*)ptr - HDR_SZ));
+    default: return 0;
+    }
+}
+
+// Try to resize a general-heap block in place, absorbing a free successor
+// when growing and returning the tail to the index when shrinking.
+static int realloc_general_inplace(Block *b, size_t size){
+    size = ALIGN_UP(size, ALIGN);
+    if (size < MIN_PAYLOAD) size = MIN_PAYLOAD;
+    if (blk_size(b) < size){
+        Block *n = blk_next_phys(b);
+        if (!n || !blk_is_free(n) || blk_size(b) + HDR_SZ + blk_size(n) < size) return 0;
+        index_remove(n);
+        b->head = (blk_size(b) + HDR_SZ + blk_size(n)) | (n->head & BLK_LAST);
+        blk_sync_next(b);
+        blk_absorbed(b);
+    }
+    (void)split_block(b, size);
+    Block *rem = blk_next_phys(b);
+    if (rem && blk_is_free(rem)){
+        Block *after = blk_next_phys(rem);
+        if (after && blk_is_free(after)){ index_remove(rem); coalesce_and_insert(rem); }
+    }
+    return 1;
+}
+
+// A buddy object shrinks in place only while a fresh request of the new size
+// would get the same slab class or order: a sized free passes that size.
+static int buddy_same_block(void *ptr, size_t size){
+    size = ALIGN_UP(size, ALIGN);
+    BuddyPage *pg = buddy_page_of(ptr);
+    size_t ord;
+    if (pg->cls) return size <= BUDDY_SMALL_MAX && buddy_class_of[size/ALIGN] + 1u == pg->cls;
+    return is_buddy_ptr(ptr, &ord, NULL) && buddy_order_for(size) == ord;
+}
+
+// realloc(NULL, n) allocates from the general heap when a strategy is
+// locked and from the buddy pool otherwise. Pool objects cannot outgrow
+// their pool and region memory cannot be resized; both return NULL.
+static void* realloc_any(void *ptr, size_t size){
+    if (!ptr){
+        if (g_strat == STRAT_UNSET) return malloc_buddy_alloc(size);
+        Block *b = allocate_general(size);
+        return b ? blk_to_ptr(b) : NULL;
+    }
+    if (size == 0){ my_free(ptr); return NULL; }
+
+    uintptr_t own = owner_of(ptr);
+    size_t old = my_usable_size(ptr);
+    void *q = NULL;
+    switch (pm_kind(own)){
+    case OWN_ARENA: {
+        Block *b = ptr_to_blk(ptr);
+        if (!(b->head & (BLK_FREE|BLK_QUICK)) && realloc_general_inplace(b, size)) return ptr;
+        Block *nb = allocate_general(size);
+        q = nb ? blk_to_ptr(nb) : NULL;
+        break;
+    }
+    case OWN_BUDDY:
+        if (size <= old && buddy_same_block(ptr, size)) return ptr;
+        q = malloc_buddy_alloc(size);
+        break;
+    case OWN_POOL:
+        return size <= old ? ptr : NULL;
+    case OWN_PHEAP:
+        if (size <= old) return ptr;
+        q = mmu_pheap_alloc((MmuPHeap*)pm_owner(own), size);
+        break;
+    default:
+        return NULL;
+    }
+    if (!q) return NULL;
+    memcpy(q, ptr, old < size ? old : size);
+    my_free(ptr);
+    return q;
+}
+
+void* my_realloc(void *ptr, size_t size){
+    MMU_TIME_BEGIN(t);
+    void *q = realloc_any(ptr, size);
+    MMU_TIME_END(realloc, t, size);
+    return q;
+}
+
+// Sized free. The buddy pool is one range, so a compare replaces the
+// page-map walk, and the caller's size picks the slab class or order: the
+// order byte is cleared by a CAS against the expected value without being
+// read first. Other pointers take owner_of as in my_free; a general-heap
+// block is freed as by my_free, and the size only feeds the debug check.
+static void free_sized(void *ptr, size_t size){
+    if (!ptr) return;
+    size = ALIGN_UP(size, ALIGN);
+    if (ptr_off(ptr) < buddy_top_size){
+        // Small sizes are slab objects, except mmu_buddy_alloc_batch's blocks.
+        if (size <= BUDDY_SMALL_MAX && buddy_page_of(ptr)->cls){
+            assert(buddy_page_of(ptr)->cls == buddy_class_of[size/ALIGN] + 1);
+            buddy_small_free(ptr);
+            return;
+        }
+        // The same CAS as buddy_free: a repeated free finds the byte clear.
+        size_t ord = buddy_order_for(size);
+        uint8_t m = BUDDY_ALLOC(ord);
+        if (__atomic_compare_exchange_n(buddy_map_at(ptr), &m, (uint8_t)0, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            buddy_put(buddy_my_heap(), ptr, ord);
+        else assert(!m);        // a size of another order
+        return;
+    }
+    OwnerKind kind = pm_kind(owner_of(ptr));
+    if (kind != OWN_ARENA){ my_free(ptr); return; }
+#ifndef NDEBUG
+    Block *b = ptr_to_blk(ptr);
+    if (size < MIN_PAYLOAD) size = MIN_PAYLOAD;
+    assert(!(b->head & (BLK_FREE|BLK_QUICK)) && blk_size(b) >= size && blk_size(b) < size + HDR_SZ + MIN_PAYLOAD);
+#else
+    (void)size;
+#endif
+    free_general(ptr);
+}
+
+void my_free_sized(void *ptr, size_t size){
+    MMU_TIME_BEGIN(t);
+    free_sized(ptr, size);
+    MMU_TIME_END(free_sized, t, size);
+}
+
+// ======================= Batch allocation / free =======================
+
+// Carve up to n blocks of `size` bytes out of one free block found with a
+// single index lookup. Returns the number of pointers written to out. With
+// no strategy locked yet it locks first fit, whose list the constructor's
+// arena is already in. Under STRAT_AUTO each block counts as one allocation,
+// recorded before the lookup as malloc_auto_fit does.
+size_t mmu_alloc_batch(size_t size, size_t n, void **out){
+    if (size == 0 || n == 0 || size > SIZE_MAX / 2) return 0;
+    if (g_strat == STRAT_UNSET) lock_strategy(STRAT_FIRST);
+    size = ALIGN_UP(size, ALIGN);
+    if (size < MIN_PAYLOAD) size = MIN_PAYLOAD;
+    size_t stride = HDR_SZ + size;
+    if (n > (SIZE_MAX / 2) / stride) return 0;     // total, and map_arena's headers on it, must not wrap
+    size_t total = n * stride - HDR_SZ;
+    if (g_auto) for (size_t i = 0; i < n; i++) auto_note_alloc(size);
+
+    Block *b = index_find(total);
+    if (b) index_remove(b);
+    else if (!(b = map_arena(total))) return 0;
+
+    size_t last_flag = b->head & BLK_LAST;
+    size_t left = blk_size(b) - total;
+    uint8_t *base = (uint8_t*)b;
+    for (size_t i = 0; i < n; i++){
+        Block *c = (Block*)(base + i * stride);
+        if (i) c->prev_size = size;
+        c->head = size;
+        out[i] = blk_to_ptr(c);
+    }
+    Block *tail = (Block*)(base + (n - 1) * stride);
+    tail->head = (size + left) | last_flag;
+    (void)split_block(tail, size);
+    blk_sync_next(tail);
+    return n;
+}
+
+// Carve n buddy blocks of one order from a single popped block: the first n
+// sub-blocks are handed out and the rest is pushed back as maximal buddies.
+size_t mmu_buddy_alloc_batch(size_t size, size_t n, void **out){
+    if (size == 0 || n == 0) return 0;
+    size = ALIGN_UP(size, ALIGN);
+    if (!buddy_ensure(size * n)) return 0;
+
+    size_t order = buddy_order_for(size);
+    if (order > buddy_pool_order) return 0;
+
+    size_t want = order;
+    while (want <= buddy_pool_order && ((size_t)1 << (want - order)) < n) want++;
+    size_t k = want;
+    uint8_t *p = NULL;
+    while (k <= buddy_pool_order && !(p = (uint8_t*)buddy_pop(k))) k++;
+    if (!p){
+        // No single block is large enough; fall back to one-at-a-time.
+        size_t got = 0;
+        while (got < n && (out[got] = malloc_buddy_alloc(size)) != NULL) got++;
+        return got;
+    }
+
+    size_t units = (size_t)1 << (k - order), unit = order_size(order);
+    for (size_t i = 0; i < n; i++) out[i] = buddy_mark(p + i * unit, order);
+    for (size_t i = n; i < units; ){
+        size_t j = 0;
+        while (!(i & ((size_t)1 << j)) && i + ((size_t)2 << j) <= units) j++;
+        buddy_push(order + j, p + i * unit);
+        i += (size_t)1 << j;
+    }
+    return n;
+}
+
+static int cmp_addr(const void *a, const void *b){
+    uintptr_t x = (uintptr_t)*(void* const*)a, y = (uintptr_t)*(void* const*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Free n pointers at once. General-heap pointers are sorted by address and
+// physically adjacent runs are merged before a single coalesce/insert per
+// run. The ptrs array is reordered in place. Under STRAT_AUTO each block of
+// a run counts as one free, recorded while the run is still allocated.
+void mmu_free_batch(void **ptrs, size_t n){
+    size_t ng = 0;
+    for (size_t i = 0; i < n; i++){
+        if (!ptrs[i]) continue;
+        if (pm_kind(pagemap_get(ptrs[i])) == OWN_ARENA) ptrs[ng++] = ptrs[i];
+        else my_free(ptrs[i]);
+    }
+    for (size_t i = 1; i < ng; i++){
+        if ((uintptr_t)ptrs[i-1] > (uintptr_t)ptrs[i]){ qsort(ptrs, ng, sizeof(void*), cmp_addr); break; }
+    }
+
+    size_t i = 0;
+    while (i < ng){
+        Block *first = ptr_to_blk(ptrs[i++]);
+        if (first->head & (BLK_FREE|BLK_QUICK)) continue;
+        Block *last = first;
+        while (i < ng && ptr_to_blk(ptrs[i]) == blk_next_phys(last) && !(ptr_to_blk(ptrs[i])->head & (BLK_FREE|BLK_QUICK)))
+            last = ptr_to_blk(ptrs[i++]);
+        if (g_auto)
+            for (Block *c = first;; c = blk_next_phys(c)){
+                auto_note_free(blk_size(c));
+                if (c == last) break;
+            }
+        if (last != first){
+            size_t sz = (size_t)((uint8_t*)last + HDR_SZ + blk_size(last) - (uint8_t*)first) - HDR_SZ;
+            first->head = sz | (last->head & BLK_LAST);
+            blk_sync_next(first);
+        }
+        first->head |= BLK_FREE;
+        coalesce_and_insert(first);
+    }
+}
+
+// ======================= Relocatable handles (online compaction) =======================
+// A handle names a general-heap object through one slot of a handle table,
+// so the compactor may move the object and rewrite the slot. The block's
+// first HANDLE_HDR payload bytes hold the slot index; a block is a live
+// handle block exactly when that slot points back at it.
+//
+// mmu_compact walks each arena in address order and slides every handle
+// block that follows a free block down over it, so the free space left
+// behind merges into one tail. Arenas that end up wholly free are unmapped
+// and the page-aligned interior of large free blocks is returned to the OS.
+// The pass is incremental: a call stops once its time budget is spent and
+// the next call resumes from the same block.
+
+#ifndef COMPACT_TRIM_MIN
+#define COMPACT_TRIM_MIN (64u<<10)
+#endif
+#define HANDLE_HDR ALIGN_UP(sizeof(uint64_t), ALIGN)
+
+typedef uint32_t MmuHandle;         // 0 is never a valid handle
+
+static uintptr_t *g_htab = NULL;    // slot: object address, or (next free << 1) | 1
+static size_t g_htab_len = 1, g_htab_cap = 0;
+static uint32_t g_htab_free = 0;
+static Arena *g_compact_arena = NULL;   // arena of the paused pass; NULL between passes
+
+static uint32_t handle_slot(void){
+    if (g_htab_free){
+        uint32_t h = g_htab_free;
+        g_htab_free = (uint32_t)(g_htab[h] >> 1);
+        return h;
+    }
+    if (g_htab_len >= g_htab_cap){
+        size_t cap = g_htab_cap ? g_htab_cap * 2 : 1024;
+        if (cap > UINT32_MAX) return 0;
+        void *t = mmap(NULL, cap * sizeof(uintptr_t), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (t == MAP_FAILED) return 0;
+        if (g_htab){
+            memcpy(t, g_htab, g_htab_len * sizeof(uintptr_t));
+            munmap(g_htab, g_htab_cap * sizeof(uintptr_t));
+        }
+        g_htab = (uintptr_t*)t;
+        g_htab_cap = cap;
+    }
+    return (uint32_t)g_htab_len++;
+}
+
+// Slot index of a live handle block, 0 for any other block.
+static inline uint32_t handle_of_blk(Block *b){
+    uint64_t h = *(uint64_t*)blk_to_ptr(b);
+    return h && h < g_htab_len && g_htab[h] == (uintptr_t)blk_to_ptr(b) + HANDLE_HDR ? (uint32_t)h : 0;
+}
+
+// Allocate size bytes from the general heap behind a handle; 0 on failure.
+static MmuHandle handle_alloc(size_t size){
+    if (size == 0 || size > SIZE_MAX - HANDLE_HDR - ALIGN) return 0;
+    uint32_t h = handle_slot();
+    if (!h) return 0;
+    Block *b = allocate_general(size + HANDLE_HDR);
+    if (!b){
+        g_htab[h] = ((uintptr_t)g_htab_free << 1) | 1;
+        g_htab_free = h;
+        return 0;
+    }
+    *(uint64_t*)blk_to_ptr(b) = h;
+    g_htab[h] = (uintptr_t)blk_to_ptr(b) + HANDLE_HDR;
+    return h;
+}
+
+MmuHandle mmu_handle_alloc(size_t size){
+    MMU_TIME_BEGIN(t);
+    MmuHandle h = handle_alloc(size);
+    MMU_TIME_END(handle_alloc, t, size);
+    return h;
+}
+
+// Current address of a handle's object; valid until the next mmu_compact.
+static inline void* mmu_handle_deref(MmuHandle h){
+    assert(h && h < g_htab_len && !(g_htab[h] & 1));
+    return (void*)g_htab[h];
+}
+
+// Usable bytes of a handle's object (my_usable_size does not apply to it).
+size_t mmu_handle_size(MmuHandle h){
+    return blk_size(ptr_to_blk((uint8_t*)mmu_handle_deref(h) - HANDLE_HDR)) - HANDLE_HDR;
+}
+
+void mmu_handle_free(MmuHandle h){
+    if (!h) return;
+    void *p = mmu_handle_deref(h);
+    g_htab[h] = ((uintptr_t)g_htab_free << 1) | 1;
+    g_htab_free = h;
+    free_general((uint8_t*)p - HANDLE_HDR);
+}
+
+// Move handle block h down over the free block f in front of it. The freed
+// bytes become a free block after h, merged with its right neighbour. A
+// migration paused on h follows it to f: h's old header may now lie inside
+// the moved data, where cursor_absorbed cannot see it.
+static Block* compact_slide(Block *f, Block *h, uint32_t slot){
+    size_t fs = blk_size(f), hs = blk_size(h), last = h->head & BLK_LAST;
+    index_remove(f);
+    if (g_migrate_cursor == h) g_migrate_cursor = f;
+    memmove(blk_to_ptr(f), blk_to_ptr(h), hs);
+    f->head = hs;
+    g_htab[slot] = (uintptr_t)blk_to_ptr(f) + HANDLE_HDR;
+
+    Block *t = (Block*)((uint8_t*)blk_to_ptr(f) + hs);
+    t->prev_size = hs;
+    t->head = fs | BLK_FREE | last;
+    coalesce_and_insert(t);
+    return t;
+}
+
+// Hand the untouched pages inside a large free block back to the OS. The
+// block's own header and index links stay resident.
+static void compact_trim(Block *b){
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t lo = ALIGN_UP((uintptr_t)b + sizeof(Block), page);
+    uintptr_t hi = ((uintptr_t)blk_to_ptr(b) + blk_size(b)) & ~(page - 1);
+    if (hi > lo) madvise((void*)lo, hi - lo, MADV_DONTNEED);
+}
+
+// Unmap ar if its only block is free, unless it is the last arena left.
+static void compact_release(Arena *ar){
+    Block *b = arena_first_blk(ar);
+    if (!blk_is_free(b) || !blk_is_last(b) || (g_arenas == ar && !ar->next)) return;
+    if (g_migrating != STRAT_UNSET) return;     // the index migration may be walking ar
+    index_remove(b);
+    Arena **pp = &g_arenas;
+    while (*pp != ar) pp = &(*pp)->next;
+    *pp = ar->next;
+    g_arena_bytes -= ar->size;
+    numa_unplace(ar);
+    pagemap_set(ar, ar->size, OWN_NONE, NULL);
+    unmap_arena(ar);
+}
+
+static inline uint64_t compact_clock_us(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+// Run the compactor for about budget_us microseconds (0: no limit). Returns
+// 1 when a full pass over the heap has finished, 0 if it paused midway.
+// A single move or trim is never split, so one call may overrun the budget
+// by the time it takes to copy the largest handle object or trim one block.
+static int compact_run(unsigned budget_us){
+    uint64_t deadline = budget_us ? compact_clock_us() + budget_us : 0;
+    if (!g_compact_arena){
+        if (g_quick_count) quick_flush();
+        if (!g_arenas) return 1;
+        g_compact_arena = g_arenas;
+        g_compact_cursor = arena_first_blk(g_arenas);
+    }
+    for (unsigned steps = 1;; steps++){
+        Block *b = g_compact_cursor, *n;
+        uint32_t slot;
+        int heavy = 0;          // this step copied or trimmed memory
+        if (!b){
+            Arena *ar = g_compact_arena;
+            g_compact_arena = ar->next;
+            compact_release(ar);
+            if (!g_compact_arena) return 1;
+            g_compact_cursor = arena_first_blk(g_compact_arena);
+            continue;
+        }
+        n = blk_next_phys(b);
+        if (blk_is_free(b) && n && (slot = handle_of_blk(n))){
+            g_compact_cursor = compact_slide(b, n, slot);
+            heavy = 1;
+        } else {
+            if (blk_is_free(b) && blk_size(b) >= COMPACT_TRIM_MIN){ compact_trim(b); heavy = 1; }
+            g_compact_cursor = n;
+        }
+        if (deadline && (heavy || !(steps & 63)) && compact_clock_us() >= deadline) return 0;
+    }
+}
+
+int mmu_compact(unsigned budget_us){
+    MMU_TIME_BEGIN(t);
+    int done = compact_run(budget_us);
+    MMU_TIME_END(compact, t, budget_us);
+    return done;
+}
+
+// ======================= Consistency check (mmu_check_heap) =======================
+// mmu_check_heap() validates the general heap and the buddy pool in time
+// linear in their size and returns the number of problems found. Nothing
+// calls it on its own, so release builds pay nothing for it; tests and
+// fuzz_heap.c run it between operations. It reads the buddy pool's shared
+// state without atomics, so no other thread may allocate meanwhile.
+//
+// General heap: blocks tile each arena with prev_size matching the
+// predecessor, the arena ends on its one BLK_LAST block, and no two free
+// blocks are neighbours. Every free block is in exactly one index (list
+// entries have avl.h == 0, tree nodes h >= 1) and the counters match. The
+// list is address-ordered with symmetric links, and the global, per-arena
+// and per-segment summaries agree with it (a segment bound may be high,
+// never low). Each tree is ordered by (size, address), has exact heights,
+// is balanced and holds only its NUMA node's blocks. No arena overlaps a
+// reservation hole.
+//
+// Buddy pool: order-map heads, BIN_FREE blocks and thread-cache entries
+// tile the pool with nothing claimed twice and no free buddies left
+// unmerged; slab pages agree with their free lists and partial lists.
+
+static size_t g_chk_bad;
+static int g_chk_verbose;
+#define CHK(cond, ...) do { if (!(cond)){ g_chk_bad++; if (g_chk_verbose) fprintf(stderr, "[check] " __VA_ARGS__); } } while (0)
+
+// The arena b lies in if b can be a block header there, else NULL.
+static Arena* chk_arena_of(const Block *b){
+    uintptr_t e = pagemap_get(b);
+    Arena *ar = (Arena*)pm_owner(e);
+    if (pm_kind(e) != OWN_ARENA || (const uint8_t*)b < (uint8_t*)arena_first_blk(ar)) return NULL;
+    if ((uintptr_t)b % ALIGN || (const uint8_t*)b + HDR_SZ + MIN_PAYLOAD > (uint8_t*)ar + ar->size) return NULL;
+    return ar;
+}
+
+typedef struct {
+    size_t narenas, nfree, free_bytes;
+    size_t nlist, ntree, nquick;        // free blocks by the index their links claim; parked blocks
+} ChkHeap;
+
+static void chk_arenas(ChkHeap *c){
+    size_t bytes = 0;
+    int compact_seen = !g_compact_arena || !g_compact_cursor;
+    int migrate_seen = g_migrating == STRAT_UNSET || !g_migrate_cursor;
+    for (Arena *ar = g_arenas; ar; ar = ar->next){
+        if (pagemap_get(ar) != ((uintptr_t)ar | OWN_ARENA) || (bytes += ar->size) > g_arena_bytes){
+            CHK(0, "arena %p: not mapped, or the list outgrows g_arena_bytes\n", (void*)ar);
+            return;
+        }
+        c->narenas++;
+        for (unsigned i = 0; i < g_rsv_nholes; i++)
+            CHK(g_rsv_hole[i].hi <= (uint8_t*)ar || g_rsv_hole[i].lo >= (uint8_t*)ar + ar->size,
+                "arena %p: overlaps a released reservation range\n", (void*)ar);
+        uint8_t *end = (uint8_t*)ar + ar->size;
+        size_t prev = 0;
+        int prev_free = 0;
+        for (Block *b = arena_first_blk(ar);;){
+            size_t sz = blk_size(b);
+            CHK(b->prev_size == prev, "block %p: prev_size %zu, predecessor has %zu\n", (void*)b, b->prev_size, prev);
+            if (sz < MIN_PAYLOAD || sz % ALIGN || sz > (size_t)(end - (uint8_t*)blk_to_ptr(b))){
+                CHK(0, "block %p: size %zu out of bounds\n", (void*)b, sz);
+                break;
+            }
+            int is_free = blk_is_free(b);
+            CHK(!(is_free && (b->head & BLK_QUICK)), "block %p: both free and quick\n", (void*)b);
+            CHK(!(is_free && prev_free), "block %p: adjacent free blocks not coalesced\n", (void*)b);
+            if (is_free){
+                c->nfree++;
+                c->free_bytes += sz;
+                if (b->avl.h) c->ntree++; else c->nlist++;
+            }
+            c->nquick += (b->head & BLK_QUICK) != 0;
+            compact_seen |= b == g_compact_cursor;
+            migrate_seen |= b == g_migrate_cursor;
+            prev = sz;
+            prev_free = is_free;
+            if (blk_is_last(b)){
+                CHK((uint8_t*)blk_to_ptr(b) + sz == end, "arena %p: last block ends %zu bytes short\n",
+                    (void*)ar, (size_t)(end - (uint8_t*)blk_to_ptr(b) - sz));
+                break;
+            }
+            b = blk_next_phys(b);
+            if ((uint8_t*)b + HDR_SZ + MIN_PAYLOAD > end){ CHK(0, "arena %p: no block marked last\n", (void*)ar); break; }
+        }
+    }
+    CHK(bytes == g_arena_bytes, "arenas hold %zu bytes, g_arena_bytes is %zu\n", bytes, g_arena_bytes);
+    CHK(compact_seen && migrate_seen, "compaction or migration cursor is not a block\n");
+}
+
+// What the list says about one arena's run of blocks.
+typedef struct {
+    Block *first, *last;
+    uint32_t count[64];
+    uint32_t seg_first[FL_SEGS];
+    uint8_t seg_max[FL_SEGS];
+} ChkRun;
+
+static void chk_fl_summary(Arena *ar, const ChkRun *r){
+    uint64_t mask = 0;
+    for (unsigned k = 0; k < 64; k++){
+        CHK(ar->fl_count[k] == r->count[k], "arena %p: %u blocks of class %u, list has %u\n", (void*)ar, ar->fl_count[k], k, r->count[k]);
+        mask |= (uint64_t)(r->count[k] != 0) << k;
+    }
+    CHK(ar->fl_first == r->first && ar->fl_last == r->last && ar->fl_mask == mask, "arena %p: run summary stale\n", (void*)ar);
+    for (unsigned s = 0; s < FL_SEGS; s++){
+        CHK(ar->fl_seg_first[s] == r->seg_first[s], "arena %p: segment %u starts at %u, list says %u\n", (void*)ar, s, ar->fl_seg_first[s], r->seg_first[s]);
+        CHK(r->seg_first[s] ? ar->fl_seg_max[s] >= r->seg_max[s] : !ar->fl_seg_max[s],
+            "arena %p: segment %u bound %u below class %u\n", (void*)ar, s, ar->fl_seg_max[s], r->seg_max[s]);
+    }
+}
+
+// Walk the address-ordered list; returns its length. Each arena's blocks
+// form one run of it and are summarised when the walk leaves the run.
+static size_t chk_list(const ChkHeap *c){
+    static ChkRun run;
+    size_t n = 0, runs = 0, cls[64] = {0};
+    int cursor_seen = !g_nextfit_cursor, finger_seen = !g_fl_finger;
+    Arena *cur = NULL;
+    Block *prev = NULL;
+    for (Block *b = g_free_head; b; prev = b, b = b->next_free){
+        Arena *ar = chk_arena_of(b);
+        if (!ar || (prev && b <= prev) || ++n > c->nfree){ CHK(0, "free list: bad link %p after %p\n", (void*)b, (void*)prev); break; }
+        CHK(b->prev_free == prev, "free list: block %p links back to %p, not %p\n", (void*)b, (void*)b->prev_free, (void*)prev);
+        CHK(blk_is_free(b) && !b->avl.h, "free list: block %p is not a free list entry\n", (void*)b);
+        if (ar != cur){
+            if (cur) chk_fl_summary(cur, &run);
+            cur = ar;
+            runs++;
+            memset(&run, 0, sizeof(run));
+            run.first = b;
+        }
+        unsigned k = fl_class(blk_size(b)), s = fl_seg(ar, b);
+        run.last = b;
+        run.count[k]++;
+        cls[k]++;
+        if (!run.seg_first[s]) run.seg_first[s] = fl_seg_off(ar, b);
+        if (k > run.seg_max[s]) run.seg_max[s] = (uint8_t)k;
+        cursor_seen |= b == g_nextfit_cursor;
+        finger_seen |= b == g_fl_finger;
+    }
+    if (cur) chk_fl_summary(cur, &run);
+    size_t busy = 0;
+    memset(&run, 0, sizeof(run));
+    for (Arena *ar = g_arenas; ar && busy <= c->narenas; ar = ar->next){
+        if (ar->fl_first) busy++;
+        else chk_fl_summary(ar, &run);
+    }
+    CHK(busy == runs, "free list: %zu arenas claim runs, the list has %zu\n", busy, runs);
+    uint64_t mask = 0;
+    for (unsigned k = 0; k < 64; k++){
+        CHK(g_fl_class_count[k] == cls[k], "free list: %zu blocks of class %u, counted %zu\n", g_fl_class_count[k], k, cls[k]);
+        mask |= (uint64_t)(cls[k] != 0) << k;
+    }
+    CHK(g_fl_class_mask == mask, "free list: class mask %llx, expected %llx\n", (unsigned long long)g_fl_class_mask, (unsigned long long)mask);
+    CHK(cursor_seen && finger_seen, "free list: next-fit cursor or finger is not on the list\n");
+    return n;
+}
+
+// Height of the subtree at b, or -1 once it is too broken to descend. lo and
+// hi bound its keys; *n counts the nodes against limit.
+static int chk_tree(Block *b, Block *lo, Block *hi, unsigned node, size_t *n, size_t limit){
+    if (!b) return 0;
+    if (!chk_arena_of(b) || ++*n > limit){ CHK(0, "tree %u: bad link %p\n", node, (void*)b); return -1; }
+    CHK(blk_is_free(b) && b->avl.h >= 1, "tree %u: block %p is not a free tree node\n", node, (void*)b);
+    CHK(blk_node(b) == node, "tree %u: block %p belongs to node %u\n", node, (void*)b, blk_node(b));
+    CHK((!lo || cmp_block(lo, b) < 0) && (!hi || cmp_block(b, hi) < 0), "tree %u: block %p out of order\n", node, (void*)b);
+    int hl = chk_tree(b->avl.l, lo, b, node, n, limit);
+    int hr = chk_tree(b->avl.r, b, hi, node, n, limit);
+    if (hl < 0 || hr < 0) return -1;
+    int h = 1 + (hl > hr ? hl : hr);
+    CHK(b->avl.h == h, "tree %u: block %p has height %d, expected %d\n", node, (void*)b, b->avl.h, h);
+    CHK(hl - hr <= 1 && hr - hl <= 1, "tree %u: block %p unbalanced (%d vs %d)\n", node, (void*)b, hl, hr);
+    return h;
+}
+
+static void chk_general(void){
+    ChkHeap c;
+    memset(&c, 0, sizeof(c));
+    chk_arenas(&c);
+    CHK(c.nfree == g_free_blocks && c.free_bytes == g_free_bytes, "index counters say %zu blocks / %zu bytes, heap has %zu / %zu\n",
+        g_free_blocks, g_free_bytes, c.nfree, c.free_bytes);
+
+    // STRAT_AUTO keeps the list's summaries exact even while on the tree.
+    int list = g_auto || g_strat == STRAT_UNSET || g_strat == STRAT_FIRST || g_strat == STRAT_NEXT || g_migrating == STRAT_FIRST;
+    int tree = g_strat == STRAT_BEST || g_strat == STRAT_WORST || g_migrating == STRAT_BEST;
+    size_t nlist = 0, ntree = 0;
+    if (list) nlist = chk_list(&c);
+    else CHK(!g_free_head, "free list in use under strategy %d\n", (int)g_strat);
+    for (unsigned n = 0; n < g_numa_nodes; n++){
+        Block *root = *avl_root_of(n);
+        CHK(tree || !root, "tree %u in use under strategy %d\n", n, (int)g_strat);
+        chk_tree(root, NULL, NULL, n, &ntree, c.nfree);
+    }
+    CHK(nlist == c.nlist && ntree == c.ntree, "index holds %zu list and %zu tree entries, heap has %zu and %zu\n",
+        nlist, ntree, c.nlist, c.ntree);
+
+    size_t nq = 0;
+    for (size_t i = 0; i < QUICK_BINS; i++)
+        for (Block *b = g_quick[i]; b; b = b->next_free){
+            if (!chk_arena_of(b) || ++nq > c.nquick){ CHK(0, "quick bin %zu: bad link %p\n", i, (void*)b); break; }
+            CHK((b->head & BLK_QUICK) && quick_bin(blk_size(b)) == i, "quick bin %zu: block %p (%zu bytes) does not belong\n", i, (void*)b, blk_size(b));
+        }
+    CHK(nq == c.nquick && nq == g_quick_count, "quick lists hold %zu blocks, heap has %zu parked, g_quick_count %zu\n", nq, c.nquick, g_quick_count);
+
+    size_t placed = 0;
+    for (unsigned n = 0; n < MMU_NUMA_MAX_NODES; n++)
+        for (Arena *ar = g_node_arenas[n]; ar; ar = ar->node_next){
+            if (++placed > c.narenas){ CHK(0, "node %u: arena list longer than the heap\n", n); break; }
+            CHK(ar->node == n && pagemap_get(ar) == ((uintptr_t)ar | OWN_ARENA), "node %u: arena %p is not one of its arenas\n", n, (void*)ar);
+        }
+    CHK(placed == c.narenas, "node lists hold %zu arenas, heap has %zu\n", placed, c.narenas);
+
+    for (size_t h = 1; h < g_htab_len; h++){
+        if (g_htab[h] & 1) continue;
+        Block *b = ptr_to_blk((uint8_t*)g_htab[h] - HANDLE_HDR);
+        CHK(chk_arena_of(b) && !(b->head & (BLK_FREE|BLK_QUICK)) && handle_of_blk(b) == h, "handle %zu: %p is not its live block\n", h, (void*)g_htab[h]);
+    }
+}
+
+// 1 if no byte of p[0..n) has any of bits set.
+static int chk_clear(const uint8_t *p, size_t n, uint8_t bits){
+    uint64_t w, m = 0x0101010101010101ull * bits, acc = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8){ memcpy(&w, p + i, 8); acc |= w & m; }
+    for (; i < n; i++) acc |= p[i] & bits;
+    return !acc;
+}
+
+// Thread-cache entries at off, current-generation heaps only; *o gets the order.
+static int chk_buddy_cached(size_t off, size_t *o){
+    int n = 0;
+    for (BuddyHeap *h = buddy_heaps; h; h = h->link){
+        if (h->gen != buddy_gen) continue;
+        for (size_t t = 0; t < BUDDY_TC_ORDERS; t++)
+            for (uint32_t j = 0; j < h->nblk[t] && j < BUDDY_TC_DEPTH; j++)
+                if (((size_t)h->blk[t][j] << BUDDY_PAGE_ORDER) == off){ *o = BUDDY_PAGE_ORDER + t; n++; }
+    }
+    return n;
+}
+
+static void chk_buddy(void){
+    size_t o0 = buddy_order0, top = buddy_pool_order, total = buddy_top_size;
+    for (size_t off = 0; off < total;){
+        size_t o = 0;
+        int claims = 0;
+        if (buddy_map[off >> o0]){ o = buddy_map[off >> o0] - 1u; claims++; }
+        for (size_t k = o0; k <= top && !(off & (order_size(k) - 1)); k++){
+            if (!(buddy_bins[k].state[off >> k] & BIN_FREE)) continue;
+            CHK(k == top || ((off >> k) & 1) || !(buddy_bins[k].state[(off >> k) ^ 1] & BIN_FREE),
+                "buddy: free buddies at %zu, order %zu, not merged\n", off, k);
+            o = k;
+            claims++;
+        }
+        if (!(off & (order_size(BUDDY_PAGE_ORDER) - 1))) claims += chk_buddy_cached(off, &o);
+        if (claims != 1 || o < o0 || o > top || (off & (order_size(o) - 1))){
+            CHK(0, "buddy: offset %zu claimed by %d blocks (order %zu)\n", off, claims, o);
+            if (claims != 1) break;
+        }
+        size_t end = off + order_size(o);
+        CHK(chk_clear(buddy_map + (off >> o0) + 1, ((end - off) >> o0) - 1, 0xff), "buddy: block at %zu, order %zu, overlaps an allocated block\n", off, o);
+        for (size_t k = o0; k < o; k++)
+            CHK(chk_clear(buddy_bins[k].state + (off >> k), (end - off) >> k, BIN_FREE), "buddy: block at %zu, order %zu, overlaps a free block of order %zu\n", off, o, k);
+        off = end;
+    }
+
+    size_t partial = 0, linked = 0;
+    for (size_t i = 0; i < buddy_npages; i++){
+        BuddyPage *pg = &buddy_pages[i];
+        if (!pg->cls) continue;
+        uint8_t *a = buddy_page_addr(pg);
+        if (pg->cls > BUDDY_NCLASS || !pg->owner){ CHK(0, "buddy page %zu: class %u, owner %p\n", i, pg->cls, (void*)pg->owner); continue; }
+        size_t sz = buddy_class_size[pg->cls - 1], nf = 0;
+        CHK(*buddy_map_at(a) == BUDDY_ALLOC(BUDDY_PAGE_ORDER), "buddy page %zu: slab not marked allocated\n", i);
+        CHK(pg->capacity == order_size(BUDDY_PAGE_ORDER) / sz && pg->bump <= pg->capacity, "buddy page %zu: %u of %u carved\n", i, pg->bump, pg->capacity);
+        for (uint8_t *p = (uint8_t*)pg->free_list; p; p = *(uint8_t**)p){
+            if (p < a || (size_t)(p - a) % sz || p >= a + (size_t)pg->bump * sz || ++nf > pg->bump){
+                CHK(0, "buddy page %zu: bad free object %p\n", i, (void*)p);
+                break;
+            }
+        }
+        CHK(pg->used + nf == pg->bump, "buddy page %zu: %u used + %zu free, %u carved\n", i, pg->used, nf, pg->bump);
+        partial += pg->owner->gen == buddy_gen && pg->used < pg->capacity;
+    }
+    for (BuddyHeap *h = buddy_heaps; h; h = h->link){
+        if (h->gen != buddy_gen) continue;
+        for (size_t c = 0; c < BUDDY_NCLASS; c++){
+            BuddyPage *prev = NULL;
+            for (BuddyPage *pg = h->partial[c]; pg; prev = pg, pg = pg->next){
+                if (pg < buddy_pages || pg >= buddy_pages + buddy_npages || ++linked > partial){ CHK(0, "buddy heap %p: bad partial link\n", (void*)h); break; }
+                CHK(pg->prev == prev && pg->cls == c + 1 && pg->owner == h && pg->used < pg->capacity,
+                    "buddy heap %p: page %zu on the wrong partial list\n", (void*)h, (size_t)(pg - buddy_pages));
+            }
+        }
+        size_t nr = 0;
+        for (void *p = h->remote; p; p = *(void**)p){
+            if (ptr_off(p) >= total || ++nr > total >> o0){ CHK(0, "buddy heap %p: bad remote link %p\n", (void*)h, p); break; }
+            CHK(buddy_page_of(p)->cls && buddy_page_of(p)->owner == h, "buddy heap %p: remote object %p is not its own\n", (void*)h, p);
+        }
+    }
+    CHK(linked == partial, "buddy: %zu pages on partial lists, %zu have room\n", linked, partial);
+}
+
+// Validate the general heap and the buddy pool. Returns the number of
+// problems found (0 = consistent); verbose reports them on stderr.
+size_t mmu_check_heap(int verbose){
+    g_chk_bad = 0;
+    g_chk_verbose = verbose;
+    chk_general();
+    if (buddy_base) chk_buddy();
+    return g_chk_bad;
+}
+#undef CHK
+
+#ifdef TEST_ALLOCATOR
+static void dump_free_list(void){
+    fprintf(stderr,"[free_list]");
+    Block *c=g_free_head; while(c){ fprintf(stderr," ->(%zu)",blk_size(c)); c=c->next_free; }
+    fprintf(stderr,"\n");
+}
+static int avl_height(Block *n){ return n? 1 + (avl_height(n->avl.l)>avl_height(n->avl.r)?avl_height(n->avl.l):avl_height(n->avl.r)) : 0; }
+
+int main(void){
+    allocator_init(STRAT_FIRST);
+
+    void *a = malloc_first_fit(1000);
+    void *b = malloc_first_fit(2000);
+    void *c = malloc_first_fit(3000);
+    fprintf(stderr,"alloc a=%p b=%p c=%p\n",a,b,c);
+
+    my_free(b);
+    my_free(a);
+    my_free(c);
+
+    void *e = malloc_buddy_alloc(1024);
+    void *f = malloc_buddy_alloc(4096);
+    fprintf(stderr,"buddy e=%p f=%p\n", e,f);
+    my_free(e); my_free(f);
+
+    for (size_t s=1;s<=64;++s){
+        void *p = malloc_first_fit(s);
+        assert(((uintptr_t)p % ALIGN)==0);
+        my_free(p);
+    }
+
+    if (g_strat==STRAT_FIRST || g_strat==STRAT_NEXT) dump_free_list();
+    if (g_strat==STRAT_BEST || g_strat==STRAT_WORST) fprintf(stderr,"[avl height] %d\n", avl_height(g_avl_root));
+    return 0;
+}
+#endif
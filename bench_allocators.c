@@ -0,0 +1,918 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sched.h>
+#include <pthread.h>
+
+/* Allocator micro-benchmarks.
+ * Strategies cannot be mixed in one process, so every (section, strategy)
+ * pair runs in its own forked child.
+ *
+ *   ./bench_allocators            run all sections
+ *   ./bench_allocators small      run only the named section(s)
+ */
+
+typedef struct {
+    const char *name;
+    Strategy strategy;
+    void* (*malloc_fn)(size_t);
+} BenchAlloc;
+
+static BenchAlloc bench_allocs[] = {
+    {"first-fit", STRAT_FIRST, malloc_first_fit},
+    {"next-fit",  STRAT_NEXT,  malloc_next_fit},
+    {"best-fit",  STRAT_BEST,  malloc_best_fit},
+    {"worst-fit", STRAT_WORST, malloc_worst_fit},
+    {"buddy",     STRAT_UNSET, malloc_buddy_alloc},  /* buddy is independent */
+};
+#define NUM_BENCH_ALLOCS (int)(sizeof(bench_allocs) / sizeof(bench_allocs[0]))
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static size_t mapped_bytes(void) {
+    size_t total = 0;
+    for (Arena *ar = g_arenas; ar; ar = ar->next) total += ar->size;
+    return total + buddy_top_size;
+}
+
+/* Physical walk of every general-heap arena: free bytes, block count, largest. */
+typedef struct {
+    size_t free_bytes, free_blocks, largest;
+} FreeStats;
+
+static FreeStats free_stats(void) {
+    FreeStats st = {0, 0, 0};
+    for (Arena *ar = g_arenas; ar; ar = ar->next) {
+        for (Block *b = (Block*)((uint8_t*)ar + ARENA_HDR_SZ); b; b = blk_next_phys(b)) {
+            if (!blk_is_free(b)) continue;
+            st.free_bytes += blk_size(b);
+            st.free_blocks++;
+            if (blk_size(b) > st.largest) st.largest = blk_size(b);
+        }
+    }
+    return st;
+}
+
+static void run_forked(void (*fn)(BenchAlloc *, int), BenchAlloc *a, int arg) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        fn(a, arg);
+        fflush(stdout);
+        _exit(0);
+    } else if (pid > 0) {
+        int status;
+        waitpid(pid, &status, 0);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * small: N small objects allocated then freed in reverse order, repeated.
+ * Reports mapped bytes per live object and ns per alloc+free pair.
+ * ------------------------------------------------------------------------- */
+static void bench_small_one(BenchAlloc *a, size_t size) {
+    const int n = 200000, rounds = 10;
+    void **ptrs = malloc(n * sizeof(void*));
+
+    allocator_init(a->strategy);
+    size_t base = mapped_bytes();
+    size_t peak = 0;
+    int live = 0;
+    double t0 = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < n; i++) ptrs[i] = a->malloc_fn(size);
+        if (r == 0) {
+            peak = mapped_bytes() - base;
+            for (int i = 0; i < n; i++) live += ptrs[i] != NULL;
+        }
+        for (int i = n - 1; i >= 0; i--) my_free(ptrs[i]);
+    }
+    double dt = now_ns() - t0;
+    if (live < n) printf("  (%s: only %d of %d allocations succeeded)\n", a->name, live, n);
+    if (!live) live = 1;
+    printf("  %-10s %4zuB objects: %6.1f bytes/object mapped (%.2fx), %6.1f ns/pair\n",
+           a->name, size, (double)peak / live, (double)peak / live / size,
+           dt / ((double)n * rounds));
+    free(ptrs);
+}
+
+static void bench_small(BenchAlloc *a) {
+    const size_t sizes[] = {16, 32, 64};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            bench_small_one(a, sizes[s]);
+            fflush(stdout);
+            _exit(0);
+        } else if (pid > 0) {
+            int status;
+            waitpid(pid, &status, 0);
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * pool: fixed-size 64B objects, random-order free, strategy malloc vs pool.
+ * ------------------------------------------------------------------------- */
+static int *random_perm(int n, unsigned seed) {
+    int *perm = malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) perm[i] = i;
+    srand(seed);
+    for (int i = n - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int t = perm[i]; perm[i] = perm[j]; perm[j] = t;
+    }
+    return perm;
+}
+
+static void bench_pool(BenchAlloc *a) {
+    const int n = 20000, rounds = 5;
+    void **ptrs = malloc(n * sizeof(void*));
+    int *perm = random_perm(n, 1);
+    allocator_init(a->strategy);
+
+    double t0 = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < n; i++) ptrs[i] = a->malloc_fn(64);
+        for (int i = 0; i < n; i++) my_free(ptrs[perm[i]]);
+    }
+    double t_heap = now_ns() - t0;
+
+    MmuPool *pool = mmu_pool_create(64, 0);
+    t0 = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < n; i++) ptrs[i] = mmu_pool_alloc(pool);
+        for (int i = 0; i < n; i++) mmu_pool_free(pool, ptrs[perm[i]]);
+    }
+    double t_pool = now_ns() - t0;
+    mmu_pool_destroy(pool);
+
+    printf("  %-10s 64B random free: heap %8.1f ns/pair, pool %5.1f ns/pair\n",
+           a->name, t_heap / ((double)n * rounds), t_pool / ((double)n * rounds));
+    free(perm);
+    free(ptrs);
+}
+
+/* ---------------------------------------------------------------------------
+ * region: request-scoped pattern, 64 mixed-size allocations that all die
+ * together; per-object free on the heap vs one mmu_region_reset.
+ * ------------------------------------------------------------------------- */
+static void bench_region(BenchAlloc *a) {
+    enum { PER_REQ = 64 };
+    const int requests = 100000;
+    size_t sizes[PER_REQ];
+    void *ptrs[PER_REQ];
+    srand(7);
+    for (int i = 0; i < PER_REQ; i++) sizes[i] = 16 + (rand() % 16) * 16;
+    allocator_init(a->strategy);
+
+    double t0 = now_ns();
+    for (int q = 0; q < requests; q++) {
+        for (int i = 0; i < PER_REQ; i++) ptrs[i] = a->malloc_fn(sizes[i]);
+        for (int i = 0; i < PER_REQ; i++) my_free(ptrs[i]);
+    }
+    double t_heap = now_ns() - t0;
+
+    MmuRegion *r = mmu_region_create(0, 1);
+    t0 = now_ns();
+    for (int q = 0; q < requests; q++) {
+        for (int i = 0; i < PER_REQ; i++) ptrs[i] = mmu_region_alloc(r, sizes[i]);
+        mmu_region_reset(r);
+    }
+    double t_region = now_ns() - t0;
+    mmu_region_destroy(r);
+
+    printf("  %-10s %d allocs/request: heap %7.1f ns/request, region %6.1f ns/request\n",
+           a->name, PER_REQ, t_heap / requests, t_region / requests);
+}
+
+/* ---------------------------------------------------------------------------
+ * batch: a decoder-style burst of 256 same-size buffers allocated and freed
+ * together; one-at-a-time vs mmu_*_alloc_batch + mmu_free_batch.
+ * ------------------------------------------------------------------------- */
+static void bench_batch(BenchAlloc *a) {
+    enum { N = 256 };
+    const int bursts = 20000;
+    void *ptrs[N];
+    size_t (*batch_fn)(size_t, size_t, void **) =
+        a->strategy == STRAT_UNSET ? mmu_buddy_alloc_batch : mmu_alloc_batch;
+    allocator_init(a->strategy);
+    void *pin = a->malloc_fn(64);   /* keep the arena from becoming one free block */
+
+    double t0 = now_ns();
+    for (int q = 0; q < bursts; q++) {
+        for (int i = 0; i < N; i++) ptrs[i] = a->malloc_fn(128);
+        for (int i = 0; i < N; i++) my_free(ptrs[i]);
+    }
+    double t_single = now_ns() - t0;
+
+    t0 = now_ns();
+    for (int q = 0; q < bursts; q++) {
+        batch_fn(128, N, ptrs);
+        mmu_free_batch(ptrs, N);
+    }
+    double t_batch = now_ns() - t0;
+    my_free(pin);
+
+    printf("  %-10s %d x 128B: single %6.1f ns/object, batch %5.1f ns/object\n",
+           a->name, N, t_single / ((double)bursts * N), t_batch / ((double)bursts * N));
+}
+
+/* ---------------------------------------------------------------------------
+ * sized: the same alloc/free churn freed through my_free vs my_free_sized,
+ * 16..512B (slab objects in the buddy pool) and, for buddy, 1..32KB (order
+ * blocks). Build with -DNDEBUG to measure the release fast path.
+ * ------------------------------------------------------------------------- */
+static void bench_sized_one(BenchAlloc *a, size_t min, size_t step, const char *label) {
+    enum { N = 1024 };
+    const int rounds = 2000;
+    void *ptrs[N];
+    size_t sizes[N];
+    srand(3);
+    for (int i = 0; i < N; i++) sizes[i] = min + (rand() % 32) * step;
+
+    /* Alternate which variant goes first so neither inherits a warmer cache. */
+    double t_plain = 0, t_sized = 0;
+    for (int r = 0; r < 2 * rounds; r++) {
+        int sized = (r & 1) ^ ((r >> 1) & 1);
+        for (int i = 0; i < N; i++) ptrs[i] = a->malloc_fn(sizes[i]);
+        double t0 = now_ns();
+        if (sized) for (int i = N - 1; i >= 0; i--) my_free_sized(ptrs[i], sizes[i]);
+        else       for (int i = N - 1; i >= 0; i--) my_free(ptrs[i]);
+        *(sized ? &t_sized : &t_plain) += now_ns() - t0;
+    }
+    printf("  %-10s %-9s free: my_free %5.1f ns, my_free_sized %5.1f ns\n",
+           a->name, label, t_plain / ((double)N * rounds), t_sized / ((double)N * rounds));
+}
+
+static void bench_sized(BenchAlloc *a) {
+    allocator_init(a->strategy);
+    bench_sized_one(a, 16, 16, "16-512B");
+    if (a->strategy == STRAT_UNSET) bench_sized_one(a, 1024, 1024, "1-32KB");
+}
+
+/* ---------------------------------------------------------------------------
+ * lazy: churn over a 4096-slot live set; 80% of replacements reuse the
+ * freed size. Eager coalescing vs quick-lists, then fragmentation after a
+ * final flush (1 - largest free / total free).
+ * ------------------------------------------------------------------------- */
+static void bench_lazy_one(BenchAlloc *a, int lazy) {
+    enum { SLOTS = 4096 };
+    const int steps = 300000;
+    static void *ptrs[SLOTS];
+    static size_t sizes[SLOTS];
+    srand(11);
+    allocator_init(a->strategy);
+    allocator_set_lazy_coalesce(lazy);
+    for (int i = 0; i < SLOTS; i++) {
+        sizes[i] = 32 + (rand() % 31) * 16;
+        ptrs[i] = a->malloc_fn(sizes[i]);
+    }
+
+    double t0 = now_ns();
+    for (int k = 0; k < steps; k++) {
+        int i = rand() % SLOTS;
+        my_free(ptrs[i]);
+        if (rand() % 5 == 0) sizes[i] = 32 + (rand() % 31) * 16;
+        ptrs[i] = a->malloc_fn(sizes[i]);
+    }
+    double dt = now_ns() - t0;
+
+    allocator_set_lazy_coalesce(0);
+    FreeStats st = free_stats();
+    printf("  %-10s %-5s %6.1f ns/step, %5zu free blocks, frag %.2f, %5.1f MB mapped\n",
+           a->name, lazy ? "lazy" : "eager", dt / steps, st.free_blocks,
+           st.free_bytes ? 1.0 - (double)st.largest / st.free_bytes : 0.0,
+           mapped_bytes() / 1048576.0);
+}
+
+static void bench_lazy(BenchAlloc *a) {
+    if (a->strategy == STRAT_UNSET) return;   /* buddy has no coalescing mode */
+    run_forked(bench_lazy_one, a, 0);
+    run_forked(bench_lazy_one, a, 1);
+}
+
+/* ---------------------------------------------------------------------------
+ * growth: a steadily growing heap. Every step allocates a 32..512B object
+ * and every fourth object is freed again, so the free list fills with small
+ * holes while new arenas keep being mapped. Reports ns per allocation.
+ * ------------------------------------------------------------------------- */
+static void bench_growth(BenchAlloc *a) {
+    if (a->strategy == STRAT_UNSET) return;   /* the buddy pool does not grow */
+    const int n = 400000;
+    void **ptrs = malloc(n * sizeof(void*));
+    srand(5);
+    allocator_init(a->strategy);
+    double t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        ptrs[i] = a->malloc_fn(32 + (rand() % 31) * 16);
+        if (i % 4 == 3) { my_free(ptrs[i - 2]); ptrs[i - 2] = NULL; }
+    }
+    double dt = now_ns() - t0;
+    int arenas = 0;
+    for (Arena *ar = g_arenas; ar; ar = ar->next) arenas++;
+    FreeStats st = free_stats();
+    printf("  %-10s %7.1f ns/alloc, %6zu free blocks, %3d arenas, %6.1f MB mapped\n",
+           a->name, dt / n, st.free_blocks, arenas, mapped_bytes() / 1048576.0);
+    free(ptrs);
+}
+
+/* ---------------------------------------------------------------------------
+ * reserve: grow the first-fit heap to 64MB in 64KB blocks, writing every
+ * page, with arenas mmapped on demand, committed from an mmu_reserve()
+ * range, or from a prefaulted one. Reports the reserve call itself and the
+ * median and worst malloc+touch. Allocator-independent, so it runs once;
+ * each mode runs in its own child since a reservation is per process.
+ * ------------------------------------------------------------------------- */
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_reserve(BenchAlloc *a) {
+    (void)a;
+    enum { BLK = 64 << 10, COUNT = 1024 };
+    const char *modes[] = {"on demand", "reserved", "prefaulted"};
+    for (int m = 0; m < 3; m++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            static double lat[COUNT];
+            double t0 = now_ns();
+            if (m && !mmu_reserve((size_t)BLK * COUNT * 2, m == 2)) _exit(1);
+            double t_rsv = now_ns() - t0;
+            allocator_init(STRAT_FIRST);
+            for (int i = 0; i < COUNT; i++) {
+                double t = now_ns();
+                uint8_t *p = malloc_first_fit(BLK);
+                for (size_t off = 0; off < BLK; off += 4096) p[off] = 1;
+                lat[i] = now_ns() - t;
+            }
+            qsort(lat, COUNT, sizeof(double), cmp_double);
+            printf("  %-10s reserve %7.2f ms, malloc+touch 64KB: p50 %6.1f us, max %7.1f us\n",
+                   modes[m], t_rsv / 1e6, lat[COUNT / 2] / 1e3, lat[COUNT - 1] / 1e3);
+            fflush(stdout);
+            _exit(0);
+        } else if (pid > 0) {
+            waitpid(pid, NULL, 0);
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * shared: producer/consumer handoff of 256KB buffers between a parent and a
+ * forked worker (same fork setup as test_all_allocators.c). The buffer is
+ * either copied through a pipe or allocated in a shared heap and handed
+ * over as an 8-byte offset; the worker reads it and frees it in place.
+ * Allocator-independent, so it runs once.
+ * ------------------------------------------------------------------------- */
+static void bench_shared(BenchAlloc *a) {
+    (void)a;
+    enum { BUF = 256 << 10, COUNT = 4000 };
+    int p[2];
+
+    /* Copy through a pipe */
+    if (pipe(p) != 0) return;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(p[1]);
+        char *dst = malloc(BUF);
+        size_t got = 0, sum = 0;
+        ssize_t r;
+        while ((r = read(p[0], dst, BUF)) > 0) { got += (size_t)r; sum += (unsigned char)dst[0]; }
+        _exit(got == (size_t)BUF * COUNT && sum ? 0 : 1);
+    }
+    close(p[0]);
+    char *src = malloc(BUF);
+    double t0 = now_ns();
+    for (int i = 0; i < COUNT; i++) {
+        memset(src, i | 1, BUF);
+        for (size_t off = 0; off < BUF; ) {
+            ssize_t w = write(p[1], src + off, BUF - off);
+            if (w <= 0) break;
+            off += (size_t)w;
+        }
+    }
+    close(p[1]);
+    waitpid(pid, NULL, 0);
+    double t_copy = now_ns() - t0;
+    free(src);
+
+    /* Zero-copy: allocate in the shared heap, send the offset */
+    int fd;
+    MmuPHeap *h = mmu_shheap_create(32 << 20, &fd);
+    if (!h || pipe(p) != 0) return;
+    pid = fork();
+    if (pid == 0) {
+        close(p[1]);
+        MmuPHeap *mine = mmu_shheap_attach(fd);
+        uint64_t off;
+        size_t sum = 0;
+        while (read(p[0], &off, sizeof(off)) == (ssize_t)sizeof(off)) {
+            unsigned char *buf = mmu_pheap_ptr(mine, off);
+            sum += buf[0] + buf[BUF - 1];
+            mmu_pheap_free(mine, buf);
+        }
+        _exit(sum ? 0 : 1);
+    }
+    close(p[0]);
+    t0 = now_ns();
+    for (int i = 0; i < COUNT; i++) {
+        char *buf;
+        while (!(buf = mmu_pheap_alloc(h, BUF))) sched_yield();   /* worker still holds the heap */
+        memset(buf, i | 1, BUF);
+        uint64_t off = mmu_pheap_off(h, buf);
+        if (write(p[1], &off, sizeof(off)) != (ssize_t)sizeof(off)) break;
+    }
+    close(p[1]);
+    waitpid(pid, NULL, 0);
+    double t_shared = now_ns() - t0;
+    mmu_shheap_detach(h);
+    close(fd);
+
+    double gb = (double)BUF * COUNT / 1e9;
+    printf("  %d x %dKB buffers: pipe copy %6.2f GB/s, shared heap handoff %6.2f GB/s (%.1fx)\n",
+           COUNT, BUF >> 10, gb / (t_copy / 1e9), gb / (t_shared / 1e9), t_copy / t_shared);
+}
+
+/* ---------------------------------------------------------------------------
+ * threads: buddy alloc/free throughput with 1..8 threads, each cycling a
+ * 32-slot ring of 16B..2KB slab objects and 4KB..16KB blocks. Compared with
+ * the same loop serialised by one global mutex. Buddy only.
+ * ------------------------------------------------------------------------- */
+#define THREAD_OPS 400000
+
+static pthread_mutex_t bench_big_lock = PTHREAD_MUTEX_INITIALIZER;
+static int bench_use_lock;
+
+static void *bench_thread_worker(void *arg) {
+    unsigned seed = (unsigned)(uintptr_t)arg;
+    void *ring[32] = {0};
+    for (int i = 0; i < THREAD_OPS; i++) {
+        unsigned r = rand_r(&seed);
+        size_t sz = (r & 3) ? 16 + (r >> 4) % 2032 : 4096u << (r >> 4) % 3;
+        if (bench_use_lock) pthread_mutex_lock(&bench_big_lock);
+        my_free(ring[i & 31]);
+        ring[i & 31] = malloc_buddy_alloc(sz);
+        if (bench_use_lock) pthread_mutex_unlock(&bench_big_lock);
+        if (ring[i & 31]) *(char*)ring[i & 31] = (char)i;
+    }
+    for (int i = 0; i < 32; i++) my_free(ring[i]);
+    return NULL;
+}
+
+static double bench_threads_run(int nthreads, int use_lock) {
+    pthread_t tid[8];
+    bench_use_lock = use_lock;
+    double t0 = now_ns();
+    for (int i = 0; i < nthreads; i++)
+        pthread_create(&tid[i], NULL, bench_thread_worker, (void*)(uintptr_t)(i + 1));
+    for (int i = 0; i < nthreads; i++) pthread_join(tid[i], NULL);
+    return (double)nthreads * THREAD_OPS / ((now_ns() - t0) / 1e3);   /* Mops/s */
+}
+
+static void bench_threads(BenchAlloc *a) {
+    if (a->strategy != STRAT_UNSET) return;
+    printf("  %ld CPUs online\n", sysconf(_SC_NPROCESSORS_ONLN));
+    double base = 0;
+    bench_threads_run(1, 0);   /* warm the pool and this thread's caches */
+    for (int t = 1; t <= 8; t *= 2) {
+        double lf = bench_threads_run(t, 0), gl = bench_threads_run(t, 1);
+        if (t == 1) base = lf;
+        printf("  %d thread%s %6.2f Mops/s (%.2fx of 1 thread), global mutex %6.2f Mops/s\n",
+               t, t == 1 ? " " : "s", lf, lf / base, gl);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * remote: one producer thread allocates 16B..512B buddy objects and hands
+ * them through single-producer rings to 1 or 3 consumer threads, which free
+ * them. Every free is a cross-thread free. Buddy only.
+ * ------------------------------------------------------------------------- */
+#define REMOTE_OBJS 2000000
+#define RING 1024
+
+typedef struct {
+    void *slot[RING];
+    unsigned head __attribute__((aligned(64)));   /* written by the producer */
+    unsigned tail __attribute__((aligned(64)));   /* written by the consumer */
+} Ring;
+
+static Ring rings[3];
+
+static void *remote_consumer(void *arg) {
+    Ring *r = arg;
+    for (;;) {
+        unsigned h = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE), t = r->tail;
+        if (t == h) { sched_yield(); continue; }
+        for (; t != h; t++) {
+            void *p = r->slot[t % RING];
+            if (!p) { __atomic_store_n(&r->tail, t + 1, __ATOMIC_RELEASE); return NULL; }
+            my_free(p);
+        }
+        __atomic_store_n(&r->tail, t, __ATOMIC_RELEASE);
+    }
+}
+
+static void remote_send(Ring *r, void *p) {
+    while (r->head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == RING) sched_yield();
+    r->slot[r->head % RING] = p;
+    __atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+}
+
+static void bench_remote(BenchAlloc *a) {
+    if (a->strategy != STRAT_UNSET) return;
+    for (int nc = 1; nc <= 3; nc += 2) {
+        pthread_t tid[3];
+        memset(rings, 0, sizeof(rings));
+        for (int i = 0; i < nc; i++) pthread_create(&tid[i], NULL, remote_consumer, &rings[i]);
+        unsigned seed = 9;
+        double t0 = now_ns();
+        for (int i = 0; i < REMOTE_OBJS; i++) {
+            void *p;
+            while (!(p = malloc_buddy_alloc(16 + rand_r(&seed) % 497))) sched_yield();
+            *(char*)p = (char)i;
+            remote_send(&rings[i % nc], p);
+        }
+        for (int i = 0; i < nc; i++) remote_send(&rings[i], NULL);
+        for (int i = 0; i < nc; i++) pthread_join(tid[i], NULL);
+        double dt = now_ns() - t0;
+        printf("  1 producer -> %d consumer%s: %6.2f M objects/s\n",
+               nc, nc == 1 ? " " : "s", REMOTE_OBJS / (dt / 1e3));
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * compact: a cache tier of 30000 handle objects (64B..2KB) loses 70% of
+ * them at random, then refills the same volume with 8KB..64KB objects.
+ * Without compaction vs with budgeted mmu_compact calls before the refill:
+ * fragmentation (1 - largest free / total free), mapped bytes and RSS
+ * before and after compaction, the longest single call, and mapped bytes
+ * once the refill is done. General heap only.
+ * ------------------------------------------------------------------------- */
+static double rss_mb(void) {
+    long pages = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) { if (fscanf(f, "%*s %ld", &pages) != 1) pages = 0; fclose(f); }
+    return pages * (double)sysconf(_SC_PAGESIZE) / 1048576.0;
+}
+
+static double frag_of(FreeStats st) {
+    return st.free_bytes ? 1.0 - (double)st.largest / st.free_bytes : 0.0;
+}
+
+static void bench_compact_one(BenchAlloc *a, int compact) {
+    enum { N = 30000 };
+    static MmuHandle hs[N];
+    srand(13);
+    allocator_init(a->strategy);
+    size_t evicted = 0;
+    for (int i = 0; i < N; i++) {
+        size_t sz = 64 + (size_t)(rand() % 1985);
+        hs[i] = mmu_handle_alloc(sz);
+        memset(mmu_handle_deref(hs[i]), 1, sz);
+    }
+    for (int i = 0; i < N; i++) {
+        if (rand() % 10 < 7) {
+            evicted += mmu_handle_size(hs[i]);
+            mmu_handle_free(hs[i]);
+            hs[i] = 0;
+        }
+    }
+
+    if (compact) {
+        FreeStats st = free_stats();
+        double frag0 = frag_of(st), mb0 = mapped_bytes() / 1048576.0, rss0 = rss_mb();
+        double worst = 0, t0 = now_ns();
+        int calls = 0, done = 0;
+        while (!done) {
+            double c0 = now_ns();
+            done = mmu_compact(500);
+            calls++;
+            if (now_ns() - c0 > worst) worst = now_ns() - c0;
+        }
+        double dt = now_ns() - t0;
+        st = free_stats();
+        printf("  %-10s compact: frag %.2f -> %.2f, %5.1f -> %5.1f MB mapped, RSS %5.1f -> %5.1f MB\n",
+               a->name, frag0, frag_of(st), mb0, mapped_bytes() / 1048576.0, rss0, rss_mb());
+        printf("  %-10s          %d calls, %.1f ms total, longest call %.2f ms (budget 0.50 ms)\n",
+               a->name, calls, dt / 1e6, worst / 1e6);
+    }
+
+    size_t refilled = 0;
+    while (refilled < evicted) {
+        size_t sz = 8192 + (size_t)(rand() % 57345);
+        MmuHandle h = mmu_handle_alloc(sz);
+        if (!h) break;
+        memset(mmu_handle_deref(h), 1, sz);
+        refilled += sz;
+    }
+    printf("  %-10s %-8s refill: %5.1f MB mapped, RSS %5.1f MB\n",
+           a->name, compact ? "compact" : "none", mapped_bytes() / 1048576.0, rss_mb());
+}
+
+static void bench_compact(BenchAlloc *a) {
+    if (a->strategy == STRAT_UNSET) return;   /* handles live in the general heap */
+    run_forked(bench_compact_one, a, 0);
+    run_forked(bench_compact_one, a, 1);
+}
+
+/* ---------------------------------------------------------------------------
+ * search: index lookups over 200k free blocks. 400k objects of 64B are
+ * allocated and every other one freed, with one hole in a thousand 2KB
+ * instead, so a 1KB request only fits the rare big holes. Rounds of 16 x
+ * 1KB allocations are then freed again. Reports ns per allocation/free pair.
+ * ------------------------------------------------------------------------- */
+static void bench_search(BenchAlloc *a) {
+    if (a->strategy == STRAT_UNSET) return;   /* buddy has no search */
+    enum { N = 400000, ROUNDS = 2000, BURST = 16 };
+    void **ptrs = malloc(N * sizeof(void*));
+    void *burst[BURST];
+    allocator_init(a->strategy);
+    for (int i = 0; i < N; i++) ptrs[i] = a->malloc_fn(i % 2000 == 0 ? 2048 : 64);
+    for (int i = 0; i < N; i += 2) my_free(ptrs[i]);
+    FreeStats st = free_stats();
+    double t0 = now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int k = 0; k < BURST; k++) burst[k] = a->malloc_fn(1024);
+        for (int k = 0; k < BURST; k++) my_free(burst[k]);
+    }
+    double dt = now_ns() - t0;
+    printf("  %-10s %8.1f ns/op over %zu free blocks\n", a->name, dt / (ROUNDS * BURST), st.free_blocks);
+    for (int i = 1; i < N; i += 2) my_free(ptrs[i]);
+    free(ptrs);
+}
+
+/* ---------------------------------------------------------------------------
+ * special: churn over a 1024-slot live set of 16..256B objects through the
+ * runtime-dispatched malloc_* / my_free and through the specialised
+ * mmu_<name>_malloc / mmu_<name>_free of the same strategy, eager and with
+ * quick-lists where an instance exists. Build with -DNDEBUG to drop the
+ * instances' debug checks. Reports the best of three passes over the same
+ * pre-generated trace, in ns per free+alloc step.
+ * ------------------------------------------------------------------------- */
+typedef struct {
+    Strategy strategy;
+    int quick;
+    void (*init)(void);
+    void* (*malloc_fn)(size_t);
+    void (*free_fn)(void *);
+} Special;
+
+static const Special specials[] = {
+    {STRAT_FIRST, 0, mmu_first_init, mmu_first_malloc, mmu_first_free},
+    {STRAT_NEXT,  0, mmu_next_init,  mmu_next_malloc,  mmu_next_free},
+    {STRAT_BEST,  0, mmu_best_init,  mmu_best_malloc,  mmu_best_free},
+    {STRAT_WORST, 0, mmu_worst_init, mmu_worst_malloc, mmu_worst_free},
+    {STRAT_FIRST, 1, mmu_first_quick_init, mmu_first_quick_malloc, mmu_first_quick_free},
+    {STRAT_BEST,  1, mmu_best_quick_init,  mmu_best_quick_malloc,  mmu_best_quick_free},
+};
+
+static void bench_special_one(BenchAlloc *a, int arg) {
+    enum { SLOTS = 1024, STEPS = 1 << 20, ROUNDS = 3 };
+    const Special *sp = &specials[arg >> 1];
+    int specialised = arg & 1;
+    static void *ptrs[SLOTS];
+    static uint16_t slot[STEPS], size[STEPS];
+    void* (*malloc_fn)(size_t) = specialised ? sp->malloc_fn : a->malloc_fn;
+    void (*free_fn)(void *) = specialised ? sp->free_fn : my_free;
+    srand(5);
+    for (int k = 0; k < STEPS; k++) {
+        slot[k] = (uint16_t)(rand() % SLOTS);
+        size[k] = (uint16_t)(16 + (rand() % 16) * 16);
+    }
+    if (specialised) sp->init();
+    else { allocator_init(a->strategy); allocator_set_lazy_coalesce(sp->quick); }
+    for (int i = 0; i < SLOTS; i++) ptrs[i] = malloc_fn(size[i]);
+    double best = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        double t0 = now_ns();
+        for (int k = 0; k < STEPS; k++) {
+            free_fn(ptrs[slot[k]]);
+            ptrs[slot[k]] = malloc_fn(size[k]);
+        }
+        double dt = now_ns() - t0;
+        if (r == 0 || dt < best) best = dt;
+    }
+    printf("  %-10s %-5s %-11s %6.1f ns/step\n", a->name, sp->quick ? "quick" : "eager",
+           specialised ? "specialised" : "dispatched", best / STEPS);
+}
+
+static void bench_special(BenchAlloc *a) {
+    for (int i = 0; i < (int)(sizeof(specials) / sizeof(specials[0])); i++) {
+        if (specials[i].strategy != a->strategy) continue;
+        run_forked(bench_special_one, a, 2 * i);
+        run_forked(bench_special_one, a, 2 * i + 1);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * kernels: the scan kernel under each instruction set the CPU supports.
+ * find_ge looks for the one byte >= 40 among 128 (an arena's segment
+ * bounds) / 4096 size classes. The target sits at a random position each call. Reports ns per
+ * call. Allocator-independent, so it runs once.
+ * ------------------------------------------------------------------------- */
+static double time_find_ge(size_t n, const uint32_t *pos, int calls) {
+    static uint8_t a[4096];
+    size_t sink = 0;
+    for (size_t i = 0; i < n; i++) a[i] = (uint8_t)(i % 40);
+    double t0 = now_ns();
+    for (int k = 0; k < calls; k++) {
+        size_t i = pos[k & 1023] % n;
+        uint8_t keep = a[i];
+        a[i] = 40;
+        sink += kern_find_ge(a, n, 40);
+        a[i] = keep;
+    }
+    double dt = now_ns() - t0;
+    if (sink == 1) printf(" ");
+    return dt / calls;
+}
+
+static void bench_kernels(BenchAlloc *unused) {
+    (void)unused;
+    static uint32_t pos[1024];
+    const char *isas[] = {"scalar", "sse4.2", "avx2"};
+    srand(9);
+    for (int i = 0; i < 1024; i++) pos[i] = (uint32_t)rand();
+    for (int i = 0; i < 3; i++) {
+        if (!mmu_kern_select(isas[i])) { printf("  %-8s not supported\n", isas[i]); continue; }
+        printf("  %-8s find_ge 128B %5.1f ns, 4KB %6.1f ns\n", isas[i],
+               time_find_ge(128, pos, 1000000), time_find_ge(4096, pos, 200000));
+    }
+    mmu_kern_select(NULL);
+}
+
+/* ---------------------------------------------------------------------------
+ * auto: replay alloc/free traces against each static strategy and
+ * STRAT_AUTO. A trace is a list of (slot, size) records, size 0 freeing the
+ * slot; all are generated up front from fixed seeds:
+ *   churn     4096 live 32..512B objects, 80% of replacements reuse the size
+ *   stack     LIFO bursts of 16B..4KB objects over a small base heap
+ *   fragment  5000 live 32B..16KB objects replaced at random
+ *   holes     20000 4KB holes, then a 512-slot FIFO of 16..256B objects
+ *   phases    stack, then fragment, then stack again
+ * Reports ns per record and MB mapped at the end; '*' marks the fastest
+ * static strategy. Allocator-independent, so it runs once.
+ * ------------------------------------------------------------------------- */
+typedef struct { uint32_t slot, size; } TraceOp;
+typedef struct { const char *name; TraceOp *ops; size_t n; } Trace;
+
+#define TRACE_SLOTS 41000
+
+static void trace_put(Trace *t, uint32_t slot, uint32_t size) {
+    t->ops[t->n].slot = slot;
+    t->ops[t->n++].size = size;
+}
+
+/* Replace random slots of a `live`-slot working set `steps` times. */
+static void trace_random(Trace *t, unsigned seed, uint32_t live, int steps,
+                         uint32_t lo, uint32_t hi, int reuse_pct) {
+    static uint32_t sz[TRACE_SLOTS];
+    srand(seed);
+    for (uint32_t i = 0; i < live; i++) trace_put(t, i, sz[i] = lo + rand() % (hi - lo + 1));
+    for (int k = 0; k < steps; k++) {
+        uint32_t i = rand() % live;
+        trace_put(t, i, 0);
+        if (rand() % 100 >= reuse_pct) sz[i] = lo + rand() % (hi - lo + 1);
+        trace_put(t, i, sz[i]);
+    }
+    for (uint32_t i = 0; i < live; i++) trace_put(t, i, 0);
+}
+
+/* LIFO bursts on top of a 256-object base; slots from 256 up form the stack. */
+static void trace_stack(Trace *t, unsigned seed, int bursts) {
+    srand(seed);
+    for (uint32_t i = 0; i < 256; i++) trace_put(t, i, 64 + rand() % 448);
+    for (int b = 0; b < bursts; b++) {
+        uint32_t depth = 1 + rand() % 200;
+        for (uint32_t d = 0; d < depth; d++) trace_put(t, 256 + d, 16 + rand() % 4081);
+        for (uint32_t d = depth; d-- > 0;) trace_put(t, 256 + d, 0);
+    }
+    for (uint32_t i = 0; i < 256; i++) trace_put(t, i, 0);
+}
+
+/* 40000 4KB objects with every other one freed, then a FIFO of small objects. */
+static void trace_holes(Trace *t, unsigned seed, int steps) {
+    srand(seed);
+    for (uint32_t i = 0; i < 40000; i++) trace_put(t, i, 4096);
+    for (uint32_t i = 0; i < 40000; i += 2) trace_put(t, i, 0);
+    for (int k = 0; k < steps; k++) {
+        uint32_t slot = 40000 + k % 512;
+        if (k >= 512) trace_put(t, slot, 0);
+        trace_put(t, slot, 16 + rand() % 241);
+    }
+    for (uint32_t i = 1; i < 40000; i += 2) trace_put(t, i, 0);
+    for (uint32_t i = 40000; i < 40512; i++) trace_put(t, i, 0);
+}
+
+static void replay(BenchAlloc *a, Trace *t, double *out) {
+    static void *live[TRACE_SLOTS];
+    allocator_init(a->strategy);
+    double t0 = now_ns();
+    for (size_t k = 0; k < t->n; k++) {
+        TraceOp op = t->ops[k];
+        if (op.size) { live[op.slot] = a->malloc_fn(op.size); *(char*)live[op.slot] = 1; }
+        else { my_free(live[op.slot]); live[op.slot] = NULL; }
+    }
+    out[0] = (now_ns() - t0) / t->n;
+    out[1] = mapped_bytes() / 1048576.0;
+}
+
+static void bench_auto(BenchAlloc *unused) {
+    (void)unused;
+    enum { NT = 5 };
+    Trace traces[NT] = {{"churn", 0, 0}, {"stack", 0, 0}, {"fragment", 0, 0}, {"holes", 0, 0}, {"phases", 0, 0}};
+    for (int i = 0; i < NT; i++) traces[i].ops = malloc(2200000 * sizeof(TraceOp));
+    trace_random(&traces[0], 11, 4096, 300000, 32, 512, 80);
+    trace_stack(&traces[1], 12, 3000);
+    trace_random(&traces[2], 13, 5000, 100000, 32, 16384, 0);
+    trace_holes(&traces[3], 14, 1000000);
+    trace_stack(&traces[4], 15, 1500);
+    trace_random(&traces[4], 16, 5000, 100000, 32, 16384, 0);
+    trace_stack(&traces[4], 17, 1500);
+
+    BenchAlloc runs[5] = {bench_allocs[0], bench_allocs[1], bench_allocs[2], bench_allocs[3],
+                          {"auto", STRAT_AUTO, malloc_auto_fit}};
+    /* Each replay runs in its own child and reports through shared memory;
+       the best of three replays is kept. */
+    double *res = mmap(NULL, 6 * 2 * sizeof(double), PROT_READ|PROT_WRITE,
+                       MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    for (int ti = 0; ti < NT; ti++) {
+        for (int r = 0; r < 5; r++) {
+            for (int rep = 0; rep < 3; rep++) {
+                pid_t pid = fork();
+                if (pid == 0) { replay(&runs[r], &traces[ti], &res[10]); _exit(0); }
+                if (pid > 0) waitpid(pid, NULL, 0);
+                if (rep == 0 || res[10] < res[2 * r]) { res[2 * r] = res[10]; res[2 * r + 1] = res[11]; }
+            }
+        }
+        int best = 0;
+        for (int r = 1; r < 4; r++) if (res[2 * r] < res[2 * best]) best = r;
+        printf("  %-8s (%zu records)\n", traces[ti].name, traces[ti].n);
+        for (int r = 0; r < 5; r++)
+            printf("    %-10s %7.1f ns/op %6.1f MB mapped%s\n", runs[r].name, res[2 * r], res[2 * r + 1],
+                   r == best ? "  *" : r == 4 ? (res[8] <= res[2 * best] * 1.05 ? "  (within 5% of *)" : "") : "");
+    }
+    munmap(res, 6 * 2 * sizeof(double));
+    for (int i = 0; i < NT; i++) free(traces[i].ops);
+}
+
+typedef struct {
+    const char *name;
+    void (*fn)(BenchAlloc *);
+    int once;               /* allocator-independent: run with the first one only */
+} BenchSection;
+
+static BenchSection sections[] = {
+    {"small", bench_small, 0},
+    {"pool",  bench_pool, 0},
+    {"region", bench_region, 0},
+    {"batch", bench_batch, 0},
+    {"sized", bench_sized, 0},
+    {"lazy", bench_lazy, 0},
+    {"growth", bench_growth, 0},
+    {"reserve", bench_reserve, 1},
+    {"shared", bench_shared, 1},
+    {"threads", bench_threads, 0},
+    {"remote", bench_remote, 0},
+    {"compact", bench_compact, 0},
+    {"search", bench_search, 0},
+    {"special", bench_special, 0},
+    {"kernels", bench_kernels, 1},
+    {"auto", bench_auto, 1},
+};
+#define NUM_SECTIONS (int)(sizeof(sections) / sizeof(sections[0]))
+
+static void run_section(BenchSection *sec) {
+    printf("== %s ==\n", sec->name);
+    fflush(stdout);
+    for (int i = 0; i < (sec->once ? 1 : NUM_BENCH_ALLOCS); i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            sec->fn(&bench_allocs[i]);
+            fflush(stdout);
+            _exit(0);
+        } else if (pid > 0) {
+            int status;
+            waitpid(pid, &status, 0);
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    for (int s = 0; s < NUM_SECTIONS; s++) {
+        int selected = (argc == 1);
+        for (int i = 1; i < argc; i++)
+            if (strcmp(argv[i], sections[s].name) == 0) selected = 1;
+        if (selected) run_section(&sections[s]);
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include "mmu.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* STL container benchmarks: std::allocator against mmu::allocator and the
+ * mmu pmr resources. A process locks one general-heap strategy, so every
+ * (section, variant) pair runs in its own forked child.
+ *
+ *   ./bench_containers            run all sections
+ *   ./bench_containers map        run only the named section(s)
+ */
+
+enum { KEYS = 200000, VECTORS = 20000, VEC_LEN = 100, ROUNDS = 3 };
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static std::vector<int> keys;
+
+/* Variants: the element allocator is picked by Alloc<T>; pmr variants use
+ * the std::pmr containers over a resource. */
+template <class T> using std_alloc = std::allocator<T>;
+template <class T> using best_alloc = mmu::allocator<T, mmu::best_fit>;
+template <class T> using first_alloc = mmu::allocator<T, mmu::first_fit>;
+
+/* ---------------------------------------------------------------------------
+ * map / unordered_map: insert KEYS random keys, look each up, erase them in
+ * another random order. Reports ns per insert+find+erase, best of ROUNDS.
+ * ------------------------------------------------------------------------- */
+template <class Map>
+static double map_round(Map& m) {
+    double t0 = now_ns();
+    for (int k : keys) m.emplace(k, k);
+    long sum = 0;
+    for (int k : keys) sum += m.find(k)->second;
+    for (size_t i = keys.size(); i-- > 0;) m.erase(keys[(i * 7919) % keys.size()]);
+    double dt = now_ns() - t0;
+    if (sum == 42 || !m.empty()) printf("  (unexpected)\n");
+    return dt / keys.size();
+}
+
+template <class MakeMap>
+static double map_best(MakeMap make) {
+    double best = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        auto m = make();
+        double t = map_round(m);
+        if (r == 0 || t < best) best = t;
+    }
+    return best;
+}
+
+/* ---------------------------------------------------------------------------
+ * vector: VECTORS vectors grown together by push_back to VEC_LEN ints each
+ * (interleaved, so reallocations of different vectors alternate), then one
+ * vector grown to KEYS * 8 ints. Reports ns per push_back, best of ROUNDS.
+ * ------------------------------------------------------------------------- */
+template <class Vec, class MakeVec>
+static void vector_best(MakeVec make, double* many, double* one) {
+    *many = *one = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        double t0 = now_ns();
+        {
+            std::vector<Vec> vs;
+            vs.reserve(VECTORS);
+            for (int i = 0; i < VECTORS; i++) vs.push_back(make());
+            for (int n = 0; n < VEC_LEN; n++)
+                for (auto& v : vs) v.push_back(n);
+        }
+        double t1 = now_ns();
+        {
+            Vec v = make();
+            for (int n = 0; n < KEYS * 8; n++) v.push_back(n);
+        }
+        double t2 = now_ns();
+        double a = (t1 - t0) / ((double)VECTORS * VEC_LEN), b = (t2 - t1) / (KEYS * 8.0);
+        if (r == 0 || a < *many) *many = a;
+        if (r == 0 || b < *one) *one = b;
+    }
+}
+
+typedef void (*Run)(const char* section);
+
+template <template <class> class A>
+static void run_alloc(const char* section) {
+    if (!strcmp(section, "map")) {
+        printf("%6.1f ns/op\n", map_best([] {
+            return std::map<int, int, std::less<int>, A<std::pair<const int, int>>>();
+        }));
+    } else if (!strcmp(section, "unordered_map")) {
+        printf("%6.1f ns/op\n", map_best([] {
+            return std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, A<std::pair<const int, int>>>();
+        }));
+    } else {
+        double many, one;
+        vector_best<std::vector<int, A<int>>>([] { return std::vector<int, A<int>>(); }, &many, &one);
+        printf("%6.1f ns/push interleaved, %5.2f ns/push single\n", many, one);
+    }
+}
+
+template <std::pmr::memory_resource* (*Get)()>
+static void run_pmr(const char* section) {
+    static std::pmr::memory_resource* res = Get();
+    if (!strcmp(section, "map")) {
+        printf("%6.1f ns/op\n", map_best([] { return std::pmr::map<int, int>(res); }));
+    } else if (!strcmp(section, "unordered_map")) {
+        printf("%6.1f ns/op\n", map_best([] { return std::pmr::unordered_map<int, int>(res); }));
+    } else {
+        double many, one;
+        vector_best<std::pmr::vector<int>>([] { return std::pmr::vector<int>(res); }, &many, &one);
+        printf("%6.1f ns/push interleaved, %5.2f ns/push single\n", many, one);
+    }
+}
+
+/* Pools in front of the best-fit heap; the region never frees. */
+static std::pmr::memory_resource* best_pool() {
+    static mmu::pool_resource pool(mmu::resource<mmu::best_fit>());
+    return &pool;
+}
+
+static std::pmr::memory_resource* region() {
+    static mmu::region_resource r;
+    return &r;
+}
+
+static const struct {
+    const char* name;
+    Run run;
+} variants[] = {
+    {"std::allocator", run_alloc<std_alloc>},
+    {"mmu best-fit", run_alloc<best_alloc>},
+    {"mmu first-fit", run_alloc<first_alloc>},
+    {"pmr mmu pool", run_pmr<best_pool>},
+    {"pmr mmu region", run_pmr<region>},
+};
+
+static const char* sections[] = {"map", "unordered_map", "vector"};
+
+int main(int argc, char** argv) {
+    srand(1);
+    keys.resize(KEYS);
+    for (int i = 0; i < KEYS; i++) keys[i] = rand();
+    for (const char* sec : sections) {
+        int selected = argc == 1;
+        for (int i = 1; i < argc; i++)
+            if (!strcmp(argv[i], sec)) selected = 1;
+        if (!selected) continue;
+        printf("== %s ==\n", sec);
+        fflush(stdout);
+        for (const auto& v : variants) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                printf("  %-15s ", v.name);
+                v.run(sec);
+                fflush(stdout);
+                _exit(0);
+            } else if (pid > 0) {
+                int status;
+                waitpid(pid, &status, 0);
+            }
+        }
+        printf("\n");
+    }
+    return 0;
+}
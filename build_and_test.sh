@@ -20,9 +20,57 @@ echo "  Compiling test_all_allocators.c..."
 gcc -Wall -g -o test_all test_all_allocators.c -lm 2>&1 | grep -v "ensure_arena" || true
 
 echo "  Compiling main.c (buddy test)..."
-gcc -Wall -g -o main_test main.c -lm 2>&1 | grep -v "ensure_arena" || true
+gcc -Wall -g -o main_test main.c -lm -pthread 2>&1 | grep -v "ensure_arena" || true
 
-if [ -f test_comprehensive ] && [ -f test_avl_complexity ] && [ -f test_all ] && [ -f main_test ]; then
+echo "  Compiling test_pool.c..."
+gcc -Wall -g -o test_pool test_pool.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling test_region.c..."
+gcc -Wall -g -o test_region test_region.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling test_pheap.c..."
+gcc -Wall -g -o test_pheap test_pheap.c -lm -pthread 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling test_handle.c..."
+gcc -Wall -g -o test_handle test_handle.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling test_auto.c..."
+gcc -Wall -g -o test_auto test_auto.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling test_kernels.c..."
+gcc -Wall -g -o test_kernels test_kernels.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling test_instances.c..."
+gcc -Wall -g -o test_instances test_instances.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling test_cpp.cpp..."
+g++ -std=c++17 -Wall -g -o test_cpp test_cpp.cpp -lm -pthread 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling test_reserve.c..."
+gcc -Wall -g -o test_reserve test_reserve.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling test_numa.c..."
+gcc -Wall -g -o test_numa test_numa.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling test_check.c..."
+gcc -Wall -g -o test_check test_check.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling fuzz_heap.c..."
+gcc -Wall -g -O1 -o fuzz_heap fuzz_heap.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling test_instrument.c..."
+gcc -Wall -g -DMMU_INSTRUMENT -o test_instrument test_instrument.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling pheap_check.c..."
+gcc -Wall -g -o pheap_check pheap_check.c -lm 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling bench_allocators.c..."
+gcc -Wall -O2 -o bench_allocators bench_allocators.c -lm -pthread 2>&1 | grep -v "ensure_arena" || true
+
+echo "  Compiling bench_containers.cpp..."
+g++ -std=c++17 -Wall -O2 -DNDEBUG -o bench_containers bench_containers.cpp -lm -pthread 2>&1 | grep -v "ensure_arena" || true
+
+if [ -f test_comprehensive ] && [ -f test_avl_complexity ] && [ -f test_all ] && [ -f main_test ] && [ -f test_pool ] && [ -f test_region ] && [ -f test_pheap ] && [ -f test_handle ] && [ -f test_auto ] && [ -f test_kernels ] && [ -f test_instances ] && [ -f test_cpp ] && [ -f test_instrument ] && [ -f test_reserve ] && [ -f test_numa ] && [ -f test_check ] && [ -f fuzz_heap ] && [ -f pheap_check ] && [ -f bench_allocators ] && [ -f bench_containers ]; then
     echo ""
     echo "✓ All tests compiled successfully"
 else
@@ -37,7 +85,7 @@ echo ""
 
 # Test 1: Comprehensive allocator test
 echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
-echo "TEST 1: Comprehensive Test (All 5 allocators × 7 tests)"
+echo "TEST 1: Comprehensive Test (All 5 allocators × 12 tests)"
 echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
 ./test_comprehensive 2>&1 | tail -30
 echo ""
@@ -58,9 +106,100 @@ echo ""
 
 # Test 4: Buddy allocator
 echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
-echo "TEST 4: Buddy Allocator (10 comprehensive tests)"
+echo "TEST 4: Buddy Allocator (14 comprehensive tests)"
 echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
 ./main_test 2>&1 | tail -20
+echo ""
+
+# Test 5: Object pools
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 5: Object Pools"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_pool 2>&1 | tail -8
+echo ""
+
+# Test 6: Regions
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 6: Regions"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_region 2>&1 | tail -8
+echo ""
+
+# Test 7: Persistent heap
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 7: Persistent Heap"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_pheap 2>&1 | tail -8
+echo ""
+
+# Test 8: Relocatable handles
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 8: Relocatable Handles and Compaction"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_handle 2>&1 | tail -8
+echo ""
+
+# Test 9: Adaptive strategy
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 9: Adaptive Strategy (STRAT_AUTO)"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_auto 2>&1 | tail -8
+echo ""
+
+# Test 10: Scan kernels
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 10: Scan Kernels (scalar/SSE4.2/AVX2)"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_kernels 2>&1 | tail -8
+echo ""
+
+# Test 11: Specialised instances
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 11: Specialised Instances (MMU_SPECIALIZE)"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_instances 2>&1 | tail -8
+echo ""
+
+# Test 12: C++ front end
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 12: C++ Front End (mmu.hpp)"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_cpp 2>&1 | tail -8
+echo ""
+
+# Test 13: Instrumentation
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 13: Instrumentation (MMU_INSTRUMENT)"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_instrument 2>&1 | tail -8
+echo ""
+
+# Test 14: Reservation
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 14: Address-Space Reservation (mmu_reserve)"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_reserve 2>&1 | tail -8
+echo ""
+
+# Test 15: NUMA placement
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 15: NUMA Placement (mmu_numa_init, fake topology)"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_numa 2>&1 | tail -8
+echo ""
+
+# Test 16: Consistency checker
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 16: Consistency Checker (mmu_check_heap)"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./test_check 2>&1 | tail -8
+echo ""
+
+# Test 17: Fuzz smoke run
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+echo "TEST 17: Fuzz Driver (random inputs, shadow model, every strategy)"
+echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
+./fuzz_heap 2>&1 | tail -8
 
 echo ""
 echo "╔═══════════════════════════════════════════════════════════════╗"
@@ -68,8 +207,21 @@ echo "║                    ALL TESTS COMPLETE ✓                       ║"
 echo "╚═══════════════════════════════════════════════════════════════╝"
 echo ""
 echo "Summary:"
-echo "  - All 5 allocators tested with 7 test cases each"
+echo "  - All 5 allocators tested with 12 test cases each"
 echo "  - O(log n) complexity verified for Best-Fit and Worst-Fit"
 echo "  - Process isolation verified"
 echo "  - Buddy allocator fully tested"
+echo "  - Object pools tested"
+echo "  - Regions tested"
+echo "  - Persistent heap tested"
+echo "  - Relocatable handles and compaction tested"
+echo "  - Adaptive strategy tested"
+echo "  - Scan kernels tested against scalar references"
+echo "  - Specialised instances tested against the malloc_* flavors"
+echo "  - C++ allocator and pmr resources tested with STL containers"
+echo "  - Latency histograms and probe counts tested"
+echo "  - Reserved, contiguous and prefaulted arenas tested"
+echo "  - Per-node arenas and indexes tested on a fake NUMA topology"
+echo "  - Heap consistency checker tested on corrupted heaps"
+echo "  - Every strategy fuzzed against a shadow model"
 echo ""
@@ -0,0 +1,331 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* Fuzz driver for the general heap and the buddy pool. An input is a byte
+ * string decoded into operations (malloc, free, sized free, realloc, batch
+ * alloc and free, buddy alloc, handles, compaction, quick-list toggling).
+ * A shadow model keeps every live object's range and contents, and
+ * mmu_check_heap() runs after each operation. A process locks one strategy,
+ * so each strategy runs in its own forked child.
+ *
+ *   ./fuzz_heap                   random inputs against every strategy
+ *   ./fuzz_heap -n 500 -s 7       500 inputs per strategy from seed 7
+ *   ./fuzz_heap crash-1 ...       replay inputs against every strategy;
+ *                                 aborts on a failure (AFL: ./fuzz_heap @@)
+ *
+ * libFuzzer:
+ *   clang -g -O1 -fsanitize=fuzzer,address -DMMU_LIBFUZZER fuzz_heap.c -o fuzz_heap
+ *   MMU_FUZZ_STRATEGY=best ./fuzz_heap corpus/     (first|next|best|worst|auto)
+ */
+
+enum { SLOTS = 64, MAX_OBJ = 6u << 20, MAX_LIVE = 64u << 20, RANDOM_LEN = 2048 };
+
+typedef enum { K_NONE, K_HEAP, K_BUDDY, K_HANDLE } Kind;
+
+typedef struct {
+    Kind kind;
+    uint8_t *p;         /* NULL for handles: the object moves, deref each time */
+    MmuHandle h;
+    size_t size;        /* bytes requested, which is what a sized free passes */
+    uint8_t fill;
+} Slot;
+
+static const struct {
+    const char *name;
+    Strategy s;
+    void *(*fn)(size_t);
+} strategies[] = {
+    {"first", STRAT_FIRST, malloc_first_fit},
+    {"next", STRAT_NEXT, malloc_next_fit},
+    {"best", STRAT_BEST, malloc_best_fit},
+    {"worst", STRAT_WORST, malloc_worst_fit},
+    {"auto", STRAT_AUTO, malloc_auto_fit},
+};
+#define NSTRAT (sizeof(strategies) / sizeof(strategies[0]))
+
+static void *(*strat_malloc)(size_t);
+static Slot slots[SLOTS];
+static size_t live_bytes, op_index;
+static uint8_t next_fill = 1;
+
+typedef struct {
+    const uint8_t *d;
+    size_t n, i;
+} Input;
+
+static unsigned take(Input *in) { return in->i < in->n ? in->d[in->i++] : 0; }
+
+/* Sizes cluster where the allocator changes behaviour: below MIN_PAYLOAD,
+ * the quick bins, the buddy slab classes, a few pages, past an arena. */
+static size_t take_size(Input *in) {
+    unsigned a = take(in), b = take(in);
+    switch (a >> 6) {
+    case 0: return a & 63 ? (a & 63) : 0;
+    case 1: return 1 + ((a & 63) << 5 | (b & 31));
+    case 2: return 1 + ((a & 63) << 10 | b << 2);
+    default: return (a & 7) ? 1 + ((size_t)((a & 63) << 8 | b) << 4) : 1 + ((size_t)b << 15);
+    }
+}
+
+static void fail(const char *what) {
+    fprintf(stderr, "fuzz_heap: op %zu: %s\n", op_index, what);
+    fflush(stdout);
+    abort();
+}
+
+static uint8_t *obj(Slot *s) { return s->kind == K_HANDLE ? (uint8_t *)mmu_handle_deref(s->h) : s->p; }
+
+static void verify(Slot *s, size_t n) {
+    const uint8_t *p = obj(s);
+    for (size_t i = 0; i < n && i < s->size; i++)
+        if (p[i] != s->fill) fail("object contents changed");
+}
+
+/* A new object must not overlap any live one and must be as large as asked. */
+static void adopt(Slot *s, Kind kind, void *p, MmuHandle h, size_t size) {
+    s->kind = kind;
+    s->p = (uint8_t *)p;
+    s->h = h;
+    s->size = size;
+    uint8_t *a = obj(s);
+    if (kind != K_HANDLE && my_usable_size(a) < size) fail("usable size below the request");
+    if (kind == K_HANDLE && mmu_handle_size(h) < size) fail("handle smaller than the request");
+    for (int i = 0; i < SLOTS; i++) {
+        Slot *o = &slots[i];
+        if (o == s || o->kind == K_NONE) continue;
+        uint8_t *b = obj(o);
+        if (a < b + o->size && b < a + size) fail("live objects overlap");
+    }
+    s->fill = next_fill++ | 1;
+    memset(a, s->fill, size);
+    live_bytes += size;
+}
+
+static void drop(Slot *s, int sized) {
+    if (s->kind == K_NONE) return;
+    verify(s, s->size);
+    live_bytes -= s->size;
+    if (s->kind == K_HANDLE) mmu_handle_free(s->h);
+    else if (sized) my_free_sized(s->p, s->size);
+    else my_free(s->p);
+    s->kind = K_NONE;
+}
+
+static int room(size_t size) { return size && size <= MAX_OBJ && live_bytes + size <= MAX_LIVE; }
+
+static void op_batch_alloc(Input *in, Slot *s, int buddy) {
+    size_t n = 1 + take(in) % 8, size = take_size(in) % 4096 + 1;
+    void *out[8];
+    for (size_t i = 0; i < n; i++) drop(&slots[(s - slots + i) % SLOTS], 0);
+    if (!room(size * n)) return;
+    size_t got = buddy ? mmu_buddy_alloc_batch(size, n, out) : mmu_alloc_batch(size, n, out);
+    for (size_t i = 0; i < got; i++) adopt(&slots[(s - slots + i) % SLOTS], buddy ? K_BUDDY : K_HEAP, out[i], 0, size);
+}
+
+static void op_batch_free(Input *in, Slot *s) {
+    size_t n = 1 + take(in) % 16, m = 0;
+    void *ptrs[16];
+    for (size_t i = 0; i < n; i++) {
+        Slot *t = &slots[(s - slots + i) % SLOTS];
+        if (t->kind == K_NONE || t->kind == K_HANDLE) continue;
+        verify(t, t->size);
+        live_bytes -= t->size;
+        ptrs[m++] = t->p;
+        t->kind = K_NONE;
+    }
+    mmu_free_batch(ptrs, m);
+}
+
+static void op_realloc(Input *in, Slot *s) {
+    size_t size = take_size(in);
+    if (s->kind == K_HANDLE) { drop(s, 0); return; }
+    if (!size || (s->kind != K_NONE && !room(size))) {
+        if (!size && s->kind != K_NONE) {
+            verify(s, s->size);
+            live_bytes -= s->size;
+            if (my_realloc(s->p, 0)) fail("realloc to 0 returned memory");
+            s->kind = K_NONE;
+        }
+        return;
+    }
+    if (s->kind == K_NONE) {
+        if (!room(size)) return;
+        void *p = my_realloc(NULL, size);
+        if (p) adopt(s, K_HEAP, p, 0, size);
+        return;
+    }
+    verify(s, s->size);
+    void *p = my_realloc(s->p, size);
+    if (!p) return;                     /* the old object stays valid */
+    uint8_t fill = s->fill;
+    for (size_t i = 0; i < size && i < s->size; i++)
+        if (((uint8_t *)p)[i] != fill) fail("realloc lost the contents");
+    live_bytes -= s->size;
+    s->kind = K_NONE;
+    adopt(s, pm_kind(pagemap_get(p)) == OWN_BUDDY ? K_BUDDY : K_HEAP, p, 0, size);
+}
+
+static void run_op(Input *in) {
+    unsigned op = take(in) % 12;
+    Slot *s = &slots[take(in) % SLOTS];
+    size_t size;
+    void *p;
+    switch (op) {
+    case 0: case 1:
+        drop(s, 0);
+        if (room(size = take_size(in)) && (p = strat_malloc(size))) adopt(s, K_HEAP, p, 0, size);
+        break;
+    case 2: drop(s, 0); break;
+    case 3: drop(s, 1); break;
+    case 4: op_realloc(in, s); break;
+    case 5:
+        drop(s, 0);
+        if (room(size = take_size(in)) && (p = malloc_buddy_alloc(size))) adopt(s, K_BUDDY, p, 0, size);
+        break;
+    case 6: op_batch_alloc(in, s, take(in) & 1); break;
+    case 7: op_batch_free(in, s); break;
+    case 8: {
+        drop(s, 0);
+        MmuHandle h;
+        if (room(size = take_size(in)) && (h = mmu_handle_alloc(size))) adopt(s, K_HANDLE, NULL, h, size);
+        break;
+    }
+    case 9:
+        mmu_compact(take(in) & 1 ? 0 : 5);
+        for (int i = 0; i < SLOTS; i++)
+            if (slots[i].kind == K_HANDLE) verify(&slots[i], slots[i].size);
+        break;
+    case 10:
+        if (!g_auto) allocator_set_lazy_coalesce(take(in) & 1);
+        break;
+    default:
+        if (s->kind != K_NONE) verify(s, s->size);
+        break;
+    }
+}
+
+/* Replay one input on the locked strategy, checking the heap after every
+ * operation, then free everything so the next input starts clean. */
+static void run_input(const uint8_t *data, size_t n) {
+    Input in = {data, n, 0};
+    for (op_index = 0; in.i < in.n; op_index++) {
+        run_op(&in);
+        if (mmu_check_heap(1)) fail("heap inconsistent");
+    }
+    for (int i = 0; i < SLOTS; i++) drop(&slots[i], i & 1);
+    if (!g_auto) allocator_set_lazy_coalesce(0);
+    if (mmu_check_heap(1)) fail("heap inconsistent after freeing everything");
+}
+
+static int lock(const char *name) {
+    for (size_t i = 0; i < NSTRAT; i++)
+        if (!strcmp(strategies[i].name, name)) {
+            allocator_init(strategies[i].s);
+            strat_malloc = strategies[i].fn;
+            return 1;
+        }
+    return 0;
+}
+
+#ifdef MMU_LIBFUZZER
+int LLVMFuzzerInitialize(int *argc, char ***argv) {
+    (void)argc; (void)argv;
+    const char *name = getenv("MMU_FUZZ_STRATEGY");
+    if (!lock(name ? name : "auto")) { fprintf(stderr, "unknown MMU_FUZZ_STRATEGY %s\n", name); exit(2); }
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    run_input(data, size);
+    return 0;
+}
+#else
+static uint64_t rng;
+
+static uint8_t rand_byte(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (uint8_t)(rng >> 24);
+}
+
+/* Run fn(strategy) in a child per strategy; returns how many failed. */
+static int each_strategy(void (*fn)(size_t, void *), void *arg) {
+    int failed = 0;
+    for (size_t i = 0; i < NSTRAT; i++) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            lock(strategies[i].name);
+            fn(i, arg);
+            fflush(stdout);
+            _exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+            printf("  %-6s FAILED\n", strategies[i].name);
+            failed++;
+        }
+    }
+    return failed;
+}
+
+static long iters = 20;
+static unsigned long seed = 1;
+
+static void random_inputs(size_t strat, void *arg) {
+    (void)arg;
+    static uint8_t buf[RANDOM_LEN];
+    size_t ops = 0;
+    for (long it = 0; it < iters; it++) {
+        rng = (seed + (uint64_t)it) * 0x9E3779B97F4A7C15ull | 1;
+        size_t n = 64 + rand_byte() * (RANDOM_LEN - 64) / 255;
+        for (size_t i = 0; i < n; i++) buf[i] = rand_byte();
+        run_input(buf, n);
+        ops += op_index;
+    }
+    printf("  %-6s %ld inputs, %zu operations checked\n", strategies[strat].name, iters, ops);
+}
+
+typedef struct {
+    const uint8_t *d;
+    size_t n;
+} File;
+
+static void replay(size_t strat, void *arg) {
+    File *f = (File *)arg;
+    run_input(f->d, f->n);
+    printf("  %-6s ok\n", strategies[strat].name);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        if (opt == 'n') iters = atol(optarg);
+        else if (opt == 's') seed = strtoul(optarg, NULL, 10);
+        else { fprintf(stderr, "usage: %s [-n inputs] [-s seed] [input-file...]\n", argv[0]); return 2; }
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    if (optind == argc) {
+        printf("=== HEAP FUZZ (random inputs, seed %lu) ===\n", seed);
+        int failed = each_strategy(random_inputs, NULL);
+        printf("Results: %d/%zu strategies passed\n", (int)NSTRAT - failed, NSTRAT);
+        return failed ? 1 : 0;
+    }
+    for (int i = optind; i < argc; i++) {
+        static uint8_t data[1 << 20];
+        FILE *fp = fopen(argv[i], "rb");
+        if (!fp) { perror(argv[i]); return 2; }
+        File f = {data, fread(data, 1, sizeof(data), fp)};
+        fclose(fp);
+        printf("%s (%zu bytes)\n", argv[i], f.n);
+        if (each_strategy(replay, &f)) abort();
+    }
+    return 0;
+}
+#endif
@@ -1,11 +1,75 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
 #include "2022MT11172mmu.h"
 
 void *malloc_buddy_alloc(size_t size);
 void my_free(void *ptr);
 
+/* Multithreaded stress: each thread allocates mixed sizes, fills them with
+ * its own pattern and hands every other block to a shared mailbox, so
+ * half of all frees happen on a different thread than the allocation. */
+#define STRESS_THREADS 4
+#define STRESS_OPS     100000
+#define STRESS_SLOTS   64
+
+static void *mailbox[STRESS_SLOTS];
+static int stress_errors;
+
+static size_t stress_size(unsigned *seed) {
+    unsigned r = rand_r(seed);
+    switch (r % 4) {
+    case 0:  return 1 + r % 2048;                 /* slab classes */
+    case 1:  return 4096u << (r >> 8) % 5;        /* cached page orders */
+    case 2:  return 1 + r % 32768;
+    default: return 65536 + r % 196608;           /* shared bins only */
+    }
+}
+
+static int stress_check(void *p) {
+    size_t n = my_usable_size(p);
+    uint8_t tag = *(uint8_t*)p;
+    for (size_t i = 0; i < n; i += 512)
+        if (((uint8_t*)p)[i] != tag) return 0;
+    return 1;
+}
+
+static void *stress_worker(void *arg) {
+    unsigned seed = (unsigned)(uintptr_t)arg;
+    void *mine[STRESS_SLOTS] = {0};
+    for (int op = 0; op < STRESS_OPS; op++) {
+        int k = rand_r(&seed) % STRESS_SLOTS;
+        void *p = mine[k];
+        if (p && op % 2) p = __atomic_exchange_n(&mailbox[k], p, __ATOMIC_ACQ_REL);
+        if (p) {
+            if (!stress_check(p)) __atomic_fetch_add(&stress_errors, 1, __ATOMIC_RELAXED);
+            my_free(p);
+        }
+        size_t sz = stress_size(&seed);
+        mine[k] = malloc_buddy_alloc(sz);
+        if (mine[k]) {
+            size_t n = my_usable_size(mine[k]);
+            uint8_t tag = (uint8_t)rand_r(&seed);
+            for (size_t i = 0; i < n; i += 512) ((uint8_t*)mine[k])[i] = tag;
+        }
+    }
+    for (int k = 0; k < STRESS_SLOTS; k++) my_free(mine[k]);
+    return NULL;
+}
+
+/* Producer/consumer: objects allocated on the main thread are freed on a
+ * consumer thread and must come back through the main thread's remote queue. */
+#define HANDOFF_OBJS 20000
+static void *handoff[HANDOFF_OBJS];
+
+static void *handoff_consumer(void *arg) {
+    (void)arg;
+    for (int i = 0; i < HANDOFF_OBJS; i++) my_free(handoff[i]);
+    return NULL;
+}
+
 /* Utility to print simple info */
 static void print_ptr(const char *name, void *p) {
     printf("%s = %p\n", name, p);
@@ -125,6 +189,77 @@ int main() {
     printf("All blocks freed successfully\n");
     printf("\n");
 
+    printf("TEST 11: Small-object slabs (dense packing, exact powers of two)\n");
+    void *objs[1000];
+    int dense = 1;
+    for (int i = 0; i < 1000; i++) {
+        objs[i] = malloc_buddy_alloc(64);
+        if (!objs[i] || ((uintptr_t)objs[i] % 64) != 0) dense = 0;
+        if (i && ((uintptr_t)objs[i] >> BUDDY_PAGE_ORDER) == ((uintptr_t)objs[i-1] >> BUDDY_PAGE_ORDER)
+              && (uint8_t*)objs[i] - (uint8_t*)objs[i-1] != 64) dense = 0;
+    }
+    print_ptr("Obj[0] (64 bytes)", objs[0]);
+    print_ptr("Obj[1] (64 bytes)", objs[1]);
+    for (int i = 0; i < 1000; i++) my_free(objs[i]);
+    void *whole = malloc_buddy_alloc(buddy_top_size);
+    print_ptr("Whole pool after freeing slabs", whole);
+    my_free(whole);
+    if (dense && whole) printf("✓ 64-byte objects packed at 64-byte stride; slab pages returned\n");
+    else { printf("✗ Small-object slabs failed\n"); return 1; }
+    printf("\n");
+
+    printf("TEST 12: Header-less blocks (exact size, natural alignment)\n");
+    void *p4k = malloc_buddy_alloc(4096);
+    void *q4k = malloc_buddy_alloc(4096);
+    void *p64k = malloc_buddy_alloc(65536);
+    print_ptr("P4K (4096 bytes)", p4k);
+    print_ptr("Q4K (4096 bytes)", q4k);
+    print_ptr("P64K (65536 bytes)", p64k);
+    int exact = p4k && q4k && p64k
+             && ((uintptr_t)((uint8_t*)p4k - (uint8_t*)buddy_base) % 4096) == 0
+             && ((uintptr_t)((uint8_t*)q4k - (uint8_t*)buddy_base) % 4096) == 0
+             && ((uintptr_t)((uint8_t*)p64k - (uint8_t*)buddy_base) % 65536) == 0
+             && (((uintptr_t)p4k ^ (uintptr_t)q4k) == 4096);
+    my_free(p4k);
+    my_free(q4k);
+    my_free(p64k);
+    void *whole2 = malloc_buddy_alloc(buddy_top_size);
+    my_free(whole2);
+    if (exact && whole2) printf("✓ 4096-byte requests get 4096-byte, 4096-aligned buddies; pool re-merged\n");
+    else { printf("✗ Header-less buddy blocks failed\n"); return 1; }
+    printf("\n");
+
+    printf("TEST 13: Concurrent alloc/free across %d threads\n", STRESS_THREADS);
+    pthread_t tid[STRESS_THREADS];
+    for (int i = 0; i < STRESS_THREADS; i++)
+        pthread_create(&tid[i], NULL, stress_worker, (void*)(uintptr_t)(i + 1));
+    for (int i = 0; i < STRESS_THREADS; i++) pthread_join(tid[i], NULL);
+    for (int k = 0; k < STRESS_SLOTS; k++) my_free(mailbox[k]);
+    void *whole3 = malloc_buddy_alloc(buddy_top_size);
+    print_ptr("Whole pool after stress", whole3);
+    my_free(whole3);
+    if (!stress_errors && whole3) printf("✓ %d ops per thread, no corruption; pool re-merged\n", STRESS_OPS);
+    else { printf("✗ Concurrent buddy stress failed (%d corrupted blocks)\n", stress_errors); return 1; }
+    printf("\n");
+
+    printf("TEST 14: Cross-thread frees return to the owning thread\n");
+    for (int i = 0; i < HANDOFF_OBJS; i++) handoff[i] = malloc_buddy_alloc(64);
+    BuddyHeap *owner = buddy_page_of(handoff[0])->owner;
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, handoff_consumer, NULL);
+    pthread_join(consumer, NULL);
+    int queued = owner == buddy_heap && owner->remote != NULL;
+    for (int i = 0; i < HANDOFF_OBJS; i++) handoff[i] = malloc_buddy_alloc(64);
+    int drained = owner->remote == NULL;
+    for (int i = 0; i < HANDOFF_OBJS; i++) my_free(handoff[i]);
+    void *whole4 = malloc_buddy_alloc(buddy_top_size);
+    my_free(whole4);
+    printf("Queued for owner: %s, drained by owner: %s, pool re-merged: %s\n",
+           queued ? "yes" : "no", drained ? "yes" : "no", whole4 ? "yes" : "no");
+    if (queued && drained && whole4) printf("✓ Remote frees went back to the owner's pages\n");
+    else { printf("✗ Remote-free queue failed\n"); return 1; }
+    printf("\n");
+
     printf("=== ALL BUDDY ALLOCATOR TESTS COMPLETE ===\n");
     return 0;
 }
@@ -0,0 +1,225 @@
+// C++ front end for 2022MT11172mmu.h: std::pmr::memory_resource classes and
+// a standard Allocator template. Like the C header it defines the allocator
+// itself, so include it in exactly one translation unit.
+//
+//   mmu::heap_resource<S>    one general-heap strategy or the buddy allocator
+//   mmu::pool_resource       size-class pools, larger requests go upstream
+//   mmu::region_resource     monotonic bump allocation, freed by release()
+//   mmu::allocator<T, S>     Allocator over the same strategies
+//
+// S is one of mmu::first_fit, next_fit, best_fit, worst_fit, auto_fit or
+// buddy. The general heap takes one strategy per process (a mix aborts) and,
+// like the pools and regions, is not thread-safe; the buddy allocator is.
+#pragma once
+
+#include "2022MT11172mmu.h"
+
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <new>
+
+namespace mmu {
+
+// Strategy tags. The fixed strategies use the specialised instances, so
+// their hot paths carry no strategy dispatch; init() locks the strategy.
+// General-heap frees read the block header to coalesce, so the size adds
+// nothing there; the buddy allocator's sized free skips the page-map walk
+// and takes the order from the size instead of reading it.
+struct first_fit {
+    static void init() { mmu_first_init(); }
+    static void* allocate(std::size_t n) noexcept { return mmu_first_malloc(n); }
+    static void deallocate(void* p, std::size_t) noexcept { mmu_first_free(p); }
+};
+
+struct next_fit {
+    static void init() { mmu_next_init(); }
+    static void* allocate(std::size_t n) noexcept { return mmu_next_malloc(n); }
+    static void deallocate(void* p, std::size_t) noexcept { mmu_next_free(p); }
+};
+
+struct best_fit {
+    static void init() { mmu_best_init(); }
+    static void* allocate(std::size_t n) noexcept { return mmu_best_malloc(n); }
+    static void deallocate(void* p, std::size_t) noexcept { mmu_best_free(p); }
+};
+
+struct worst_fit {
+    static void init() { mmu_worst_init(); }
+    static void* allocate(std::size_t n) noexcept { return mmu_worst_malloc(n); }
+    static void deallocate(void* p, std::size_t) noexcept { mmu_worst_free(p); }
+};
+
+struct auto_fit {
+    static void init() { allocator_init(STRAT_AUTO); }
+    static void* allocate(std::size_t n) noexcept { return malloc_auto_fit(n); }
+    static void deallocate(void* p, std::size_t n) noexcept { my_free_sized(p, n); }
+};
+
+struct buddy {
+    static void init() {}
+    static void* allocate(std::size_t n) noexcept { return malloc_buddy_alloc(n); }
+    static void deallocate(void* p, std::size_t n) noexcept { my_free_sized(p, n); }
+};
+
+namespace detail {
+
+template <class S>
+inline void ensure_init() {
+    static const bool done = (S::init(), true);
+    (void)done;
+}
+
+// Alignments above ALIGN over-allocate by the alignment and keep the
+// original pointer in the word below the aligned one.
+template <class S>
+inline void* allocate(std::size_t bytes, std::size_t align) {
+    if (bytes == 0) bytes = 1;
+    if (align <= ALIGN) {
+        void* p = S::allocate(bytes);
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+    if (bytes > std::numeric_limits<std::size_t>::max() - align) throw std::bad_alloc();
+    void* raw = S::allocate(bytes + align);
+    if (!raw) throw std::bad_alloc();
+    uintptr_t p = ALIGN_UP((uintptr_t)raw + sizeof(void*), align);
+    ((void**)p)[-1] = raw;
+    return (void*)p;
+}
+
+template <class S>
+inline void deallocate(void* p, std::size_t bytes, std::size_t align) noexcept {
+    if (bytes == 0) bytes = 1;
+    if (align <= ALIGN) S::deallocate(p, bytes);
+    else S::deallocate(((void**)p)[-1], bytes + align);
+}
+
+} // namespace detail
+
+template <class S>
+class heap_resource final : public std::pmr::memory_resource {
+public:
+    heap_resource() { detail::ensure_init<S>(); }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        return detail::allocate<S>(bytes, align);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        detail::deallocate<S>(p, bytes, align);
+    }
+    // Every resource of one strategy draws from the same heap.
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return dynamic_cast<const heap_resource*>(&other) != nullptr;
+    }
+};
+
+// Process-wide resource of a strategy, like std::pmr::new_delete_resource().
+template <class S>
+inline heap_resource<S>* resource() {
+    static heap_resource<S> r;
+    return &r;
+}
+
+#ifndef MMU_PMR_POOL_MAX
+#define MMU_PMR_POOL_MAX 1024u
+#endif
+
+// One mmu_pool per ALIGN size class up to MMU_PMR_POOL_MAX, created on first
+// use. Larger or over-aligned requests go to the upstream resource; like the
+// std pools it defaults to std::pmr::get_default_resource(), so a pool locks
+// no strategy unless given mmu::resource<S>().
+class pool_resource final : public std::pmr::memory_resource {
+public:
+    explicit pool_resource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : upstream_(upstream) {}
+    pool_resource(const pool_resource&) = delete;
+    pool_resource& operator=(const pool_resource&) = delete;
+    ~pool_resource() override { release(); }
+
+    // Frees every pooled object at once; upstream allocations are not tracked.
+    void release() {
+        for (auto& pool : pools_) { mmu_pool_destroy(pool); pool = nullptr; }
+    }
+    std::pmr::memory_resource* upstream_resource() const { return upstream_; }
+
+private:
+    static constexpr std::size_t classes = MMU_PMR_POOL_MAX / ALIGN;
+
+    static std::size_t class_of(std::size_t bytes) { return bytes ? (bytes - 1) / ALIGN : 0; }
+
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        if (bytes > MMU_PMR_POOL_MAX || align > ALIGN) return upstream_->allocate(bytes, align);
+        MmuPool*& pool = pools_[class_of(bytes)];
+        if (!pool && !(pool = mmu_pool_create((class_of(bytes) + 1) * ALIGN, 0))) throw std::bad_alloc();
+        void* p = mmu_pool_alloc(pool);
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+        if (bytes > MMU_PMR_POOL_MAX || align > ALIGN) upstream_->deallocate(p, bytes, align);
+        else mmu_pool_free(pools_[class_of(bytes)], p);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    MmuPool* pools_[classes] = {};
+};
+
+// Monotonic: deallocate is a no-op and release() drops everything at once.
+class region_resource final : public std::pmr::memory_resource {
+public:
+    explicit region_resource(std::size_t chunk_size = 0, bool keep_warm = false)
+        : region_(mmu_region_create(chunk_size, keep_warm)) {
+        if (!region_) throw std::bad_alloc();
+    }
+    region_resource(const region_resource&) = delete;
+    region_resource& operator=(const region_resource&) = delete;
+    ~region_resource() override { mmu_region_destroy(region_); }
+
+    void release() { mmu_region_reset(region_); }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        if (bytes == 0) bytes = 1;
+        std::size_t pad = align > ALIGN ? align - ALIGN : 0;
+        void* p = mmu_region_alloc(region_, bytes + pad);
+        if (!p) throw std::bad_alloc();
+        return (void*)ALIGN_UP((uintptr_t)p, align > ALIGN ? align : ALIGN);
+    }
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    MmuRegion* region_;
+};
+
+// Stateless Allocator; deallocate passes the size through to S.
+template <class T, class S = best_fit>
+struct allocator {
+    using value_type = T;
+    template <class U> struct rebind { using other = allocator<U, S>; };
+
+    allocator() noexcept { detail::ensure_init<S>(); }
+    template <class U>
+    allocator(const allocator<U, S>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+        return static_cast<T*>(detail::allocate<S>(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* p, std::size_t n) noexcept {
+        detail::deallocate<S>(p, n * sizeof(T), alignof(T));
+    }
+};
+
+template <class T, class U, class S>
+inline bool operator==(const allocator<T, S>&, const allocator<U, S>&) noexcept { return true; }
+template <class T, class U, class S>
+inline bool operator!=(const allocator<T, S>&, const allocator<U, S>&) noexcept { return false; }
+
+} // namespace mmu
@@ -0,0 +1,24 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+
+/* Offline consistency checker for persistent heap files (mmu_pheap_*).
+ *
+ *   ./pheap_check heap.img [more.img ...]
+ *
+ * Exit status is 0 when every file is consistent.
+ */
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s heap-file...\n", argv[0]);
+        return 2;
+    }
+    int failed = 0;
+    for (int i = 1; i < argc; i++) {
+        long bad = mmu_pheap_check(argv[i], 1);
+        if (bad < 0) { perror(argv[i]); failed = 1; }
+        else if (bad) { printf("%s: %ld problem(s)\n", argv[i], bad); failed = 1; }
+        else printf("%s: ok\n", argv[i]);
+    }
+    return failed;
+}
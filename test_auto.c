@@ -0,0 +1,209 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Adaptive strategy (STRAT_AUTO) test suite */
+
+enum { SLOTS = 20000 };
+static void *objs[SLOTS];
+static size_t sz[SLOTS];
+
+static void fill(int i) { memset(objs[i], (int)(i * 7 + 1), sz[i]); }
+
+static int check(int i) {
+    uint8_t *p = objs[i];
+    for (size_t k = 0; k < sz[i]; k++)
+        if (p[k] != (uint8_t)(i * 7 + 1)) return 0;
+    return 1;
+}
+
+static void put(int i, size_t size) {
+    sz[i] = size;
+    objs[i] = malloc_auto_fit(size);
+    fill(i);
+}
+
+static void release(int i) { my_free(objs[i]); objs[i] = NULL; }
+
+/* 1 if every boundary tag agrees and the index holds exactly the free blocks. */
+static int heap_consistent(void) {
+    size_t nfree = 0, bytes = 0;
+    for (Arena *ar = g_arenas; ar; ar = ar->next) {
+        size_t prev = 0;
+        for (Block *b = arena_first_blk(ar); b; b = blk_next_phys(b)) {
+            if (b->prev_size != prev) return 0;
+            if (blk_is_free(b)) { nfree++; bytes += blk_size(b); }
+            prev = blk_size(b);
+        }
+    }
+    return nfree == g_free_blocks && bytes == g_free_bytes;
+}
+
+static int test_holes_stay_on_list(void) {
+    printf("TEST 1: Small objects over many big holes stay on the list\n");
+    enum { BIG = 16000, RING = 512 };
+    for (int i = 0; i < BIG; i++) put(i, 4096);
+    for (int i = 0; i < BIG; i += 2) release(i);
+    srand(1);
+    for (int k = 0; k < 400000; k++) {
+        int i = BIG + k % RING;
+        if (objs[i]) release(i);
+        put(i, 16 + (size_t)(rand() % 240));
+    }
+    printf("  strategy %d, %zu free blocks\n", g_strat, g_free_blocks);
+    if (g_strat != STRAT_FIRST || g_migrating != STRAT_UNSET) {
+        printf("  ✗ FAIL: first fit finds a hole at the front; expected the list\n");
+        return 0;
+    }
+    for (int i = 1; i < BIG; i += 2)
+        if (!check(i)) { printf("  ✗ FAIL: object %d corrupted\n", i); return 0; }
+    for (int i = 0; i < SLOTS; i++) if (objs[i]) release(i);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_fragment_moves_to_tree(void) {
+    printf("TEST 2: A fragmenting workload moves to the tree; migration keeps the heap intact\n");
+    enum { LIVE = 5000 };
+    srand(2);
+    for (int i = 0; i < LIVE; i++) put(i, 32 + (size_t)(rand() % 16353));
+    int migrating_ops = 0, saw_tree = 0;
+    for (int k = 0; k < 60000; k++) {
+        int i = rand() % LIVE;
+        release(i);
+        put(i, 32 + (size_t)(rand() % 16353));
+        if (g_migrating != STRAT_UNSET) {
+            migrating_ops++;
+            if (!heap_consistent()) { printf("  ✗ FAIL: heap inconsistent mid-migration at op %d\n", k); return 0; }
+        }
+        if (g_strat == STRAT_BEST) saw_tree = 1;
+    }
+    printf("  %d operations ran mid-migration, strategy now %d\n", migrating_ops, g_strat);
+    if (!saw_tree || !migrating_ops) { printf("  ✗ FAIL: never moved to the tree\n"); return 0; }
+    for (int i = 0; i < LIVE; i++)
+        if (!check(i)) { printf("  ✗ FAIL: object %d corrupted\n", i); return 0; }
+    for (int i = 0; i < LIVE; i++) release(i);
+    if (!heap_consistent()) { printf("  ✗ FAIL: heap inconsistent after freeing everything\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_churn_enables_quick_lists(void) {
+    printf("TEST 3: Same-size churn turns the quick-lists on\n");
+    enum { LIVE = 4096 };
+    srand(3);
+    for (int i = 0; i < LIVE; i++) put(i, 32 + (size_t)(rand() % 481));
+    int on = 0;
+    for (int k = 0; k < 50000; k++) {
+        int i = rand() % LIVE;
+        size_t keep = sz[i];
+        release(i);
+        put(i, rand() % 100 < 80 ? keep : 32 + (size_t)(rand() % 481));
+        on |= g_lazy_coalesce;
+    }
+    if (!on) { printf("  ✗ FAIL: quick-lists never turned on\n"); return 0; }
+    for (int i = 0; i < LIVE; i++)
+        if (!check(i)) { printf("  ✗ FAIL: object %d corrupted\n", i); return 0; }
+    for (int i = 0; i < LIVE; i++) release(i);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_general_api(void) {
+    printf("TEST 4: realloc, usable size and sized free work under STRAT_AUTO\n");
+    char *p = malloc_auto_fit(100);
+    strcpy(p, "adaptive");
+    p = my_realloc(p, 50000);
+    if (!p || strcmp(p, "adaptive") != 0) { printf("  ✗ FAIL: realloc lost the contents\n"); return 0; }
+    void *z = malloc_auto_fit(1000);
+    if (my_usable_size(z) < 1000) { printf("  ✗ FAIL: usable size %zu\n", my_usable_size(z)); return 0; }
+    void *s = malloc_auto_fit(300);
+    my_free_sized(s, 300);
+    my_free(z);
+    my_free(p);
+    while (g_migrating != STRAT_UNSET) my_free(malloc_auto_fit(64));
+    if (!heap_consistent()) { printf("  ✗ FAIL: heap inconsistent\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+/* A migration paused on a handle block, then a compaction that slides the
+ * handle down over a smaller free block in front of it. */
+static int test_compact_mid_migration(void) {
+    printf("TEST 5: Compaction slides a handle the index migration is paused on\n");
+    while (g_migrating != STRAT_UNSET) my_free(malloc_auto_fit(64));
+    void *a = malloc_auto_fit(32);
+    MmuHandle h = mmu_handle_alloc(2000);
+    memset(mmu_handle_deref(h), 0x5a, 2000);
+    Block *hb = ptr_to_blk((uint8_t*)mmu_handle_deref(h) - HANDLE_HDR);
+    if (blk_next_phys(ptr_to_blk(a)) != hb) { printf("  ✗ FAIL: handle not carved after the small block\n"); return 0; }
+    my_free(a);
+    auto_switch(g_strat == STRAT_FIRST ? STRAT_BEST : STRAT_FIRST);
+    g_migrate_arena = fl_arena_of(hb);
+    g_migrate_cursor = hb;
+    mmu_compact(0);
+    if (mmu_check_heap(1)) { printf("  ✗ FAIL: compaction left the heap inconsistent\n"); return 0; }
+    while (g_migrating != STRAT_UNSET) my_free(malloc_auto_fit(64));
+    uint8_t *p = mmu_handle_deref(h);
+    for (int k = 0; k < 2000; k++)
+        if (p[k] != 0x5a) { printf("  ✗ FAIL: handle contents lost\n"); return 0; }
+    mmu_handle_free(h);
+    if (!heap_consistent() || mmu_check_heap(1)) { printf("  ✗ FAIL: heap inconsistent after migration\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+/* Batch calls count each block as one operation, so a workload driven only
+ * through mmu_alloc_batch / mmu_free_batch still closes decision windows. */
+static int test_batches_drive_decisions(void) {
+    printf("TEST 6: Batch allocation and free drive the adaptive strategy\n");
+    enum { GROUPS = 3000, PER = 3 };
+    static void *g[GROUPS][PER];
+    static size_t n[GROUPS];
+    while (g_migrating != STRAT_UNSET) my_free(malloc_auto_fit(64));
+    if (g_strat != STRAT_FIRST) {
+        auto_switch(STRAT_FIRST);
+        while (g_migrating != STRAT_UNSET) my_free(malloc_auto_fit(64));
+    }
+    auto_window_reset();
+    void *out[100];
+    if (mmu_alloc_batch(64, 100, out) != 100 || g_auto_stats.allocs != 100) {
+        printf("  ✗ FAIL: batch of 100 counted as %u allocations\n", (unsigned)g_auto_stats.allocs);
+        return 0;
+    }
+    mmu_free_batch(out, 100);
+    if (g_auto_stats.frees != 100) {
+        printf("  ✗ FAIL: batch of 100 counted as %u frees\n", (unsigned)g_auto_stats.frees);
+        return 0;
+    }
+    g_auto_windows = 0;
+    srand(6);
+    for (int i = 0; i < GROUPS; i++) n[i] = mmu_alloc_batch(32 + (size_t)(rand() % 16353), 1 + rand() % PER, g[i]);
+    for (int k = 0; k < 3000; k++) {
+        int i = rand() % GROUPS;
+        mmu_free_batch(g[i], n[i]);
+        n[i] = mmu_alloc_batch(32 + (size_t)(rand() % 16353), 1 + rand() % PER, g[i]);
+    }
+    printf("  %u windows closed on the list, strategy now %d\n", g_auto_windows, g_strat);
+    if (g_strat == STRAT_FIRST && g_auto_windows < 4) { printf("  ✗ FAIL: batches did not reach auto_decide\n"); return 0; }
+    for (int i = 0; i < GROUPS; i++) mmu_free_batch(g[i], n[i]);
+    while (g_migrating != STRAT_UNSET) my_free(malloc_auto_fit(64));
+    if (!heap_consistent() || mmu_check_heap(1)) { printf("  ✗ FAIL: heap inconsistent\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main(void) {
+    printf("=== ADAPTIVE STRATEGY TEST SUITE ===\n\n");
+    allocator_init(STRAT_AUTO);
+    int passed = 0, total = 6;
+    passed += test_holes_stay_on_list();
+    passed += test_fragment_moves_to_tree();
+    passed += test_churn_enables_quick_lists();
+    passed += test_general_api();
+    passed += test_compact_mid_migration();
+    passed += test_batches_drive_decisions();
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}
@@ -137,6 +137,13 @@ static void test_complexity(const char *name, Strategy strategy, void* (*malloc_
             g_free_head = NULL;
             g_nextfit_cursor = NULL;
             g_avl_root = NULL;
+            g_arena_bytes = 0;
+            memset(g_node_arenas, 0, sizeof(g_node_arenas));
+            memset(g_node_avl, 0, sizeof(g_node_avl));
+            g_fl_finger = NULL;
+            memset(g_fl_class_count, 0, sizeof(g_fl_class_count));
+            g_fl_class_mask = 0;
+            g_free_blocks = g_free_bytes = 0;
             g_strat = STRAT_UNSET;
             
             allocator_init(strategy);
@@ -0,0 +1,230 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* Consistency checker (mmu_check_heap) test suite. Each case breaks one
+ * invariant by hand, expects the checker to report it, and expects a clean
+ * report once it is repaired. A process locks one strategy, so each case
+ * forks. */
+
+static int in_child(int (*fn)(void)) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) _exit(fn() ? 0 : 1);
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static Strategy child_strategy;
+static void* (*child_malloc)(size_t);
+static void *ptrs[4000];
+
+/* Mixed sizes, every third block freed: plenty of free blocks in the index. */
+static void churn(void) {
+    for (int i = 0; i < 4000; i++) ptrs[i] = child_malloc(16 + (size_t)(i * 37 % 3000));
+    for (int i = 0; i < 4000; i += 3) my_free(ptrs[i]);
+}
+
+/* Expect the broken state to be reported, then a clean check once fixed. */
+static int caught(const char *what, size_t bad, size_t after) {
+    printf("  %-40s %zu problem(s), %zu after repair\n", what, bad, after);
+    return bad > 0 && after == 0;
+}
+
+static int clean_child(void) {
+    allocator_init(child_strategy);
+    churn();
+    void *b[200];
+    for (int i = 0; i < 200; i++) b[i] = malloc_buddy_alloc(16 + (size_t)(i * 97 % 9000));
+    for (int i = 0; i < 200; i += 2) my_free(b[i]);
+    MmuHandle h[100];
+    for (int i = 0; i < 100; i++) h[i] = mmu_handle_alloc(100 + (size_t)i * 10);
+    for (int i = 0; i < 100; i += 2) mmu_handle_free(h[i]);
+    if (mmu_compact(5) != 1 && mmu_check_heap(1)) return 0;   /* paused mid-pass */
+    if (child_strategy != STRAT_AUTO) allocator_set_lazy_coalesce(1);
+    for (int i = 1; i < 4000; i += 3) my_free(ptrs[i]);
+    if (mmu_check_heap(1)) return 0;
+    allocator_set_lazy_coalesce(0);
+    mmu_compact(0);
+    return mmu_check_heap(1) == 0;
+}
+
+static int test_clean(void) {
+    static const struct { const char *name; Strategy s; void* (*fn)(size_t); } all[] = {
+        {"first", STRAT_FIRST, malloc_first_fit}, {"next", STRAT_NEXT, malloc_next_fit},
+        {"best", STRAT_BEST, malloc_best_fit},    {"worst", STRAT_WORST, malloc_worst_fit},
+        {"auto", STRAT_AUTO, malloc_auto_fit},
+    };
+    printf("TEST 1: A heap worked by each strategy checks clean\n");
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+        child_strategy = all[i].s;
+        child_malloc = all[i].fn;
+        if (!in_child(clean_child)) { printf("  ✗ FAIL: %s heap reported inconsistent\n", all[i].name); return 0; }
+    }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static Block *some_free(void) {
+    for (Block *b = arena_first_blk(g_arenas); b; b = blk_next_phys(b))
+        if (blk_is_free(b) && blk_next_phys(b) && !blk_is_free(blk_next_phys(b))) return b;
+    return NULL;
+}
+
+static int tags_child(void) {
+    allocator_init(STRAT_FIRST);
+    child_malloc = malloc_first_fit;
+    churn();
+    Block *b = some_free(), *n = blk_next_phys(b);
+    int ok = 1;
+    n->prev_size += ALIGN;
+    size_t bad = mmu_check_heap(0);
+    n->prev_size -= ALIGN;
+    ok &= caught("prev_size of a successor", bad, mmu_check_heap(0));
+    n->head |= BLK_FREE;                      /* two free neighbours */
+    bad = mmu_check_heap(0);
+    n->head &= ~BLK_FREE;
+    ok &= caught("free block next to a free block", bad, mmu_check_heap(0));
+    Block *last = b;
+    while (!blk_is_last(last)) last = blk_next_phys(last);
+    last->head &= ~BLK_LAST;                  /* walk runs off the arena */
+    bad = mmu_check_heap(0);
+    last->head |= BLK_LAST;
+    ok &= caught("last block not marked", bad, mmu_check_heap(0));
+    return ok;
+}
+
+static int test_tags(void) {
+    printf("TEST 2: Boundary tags: prev_size, coalescing, the last block\n");
+    if (!in_child(tags_child)) { printf("  ✗ FAIL: broken tags not reported\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int list_child(void) {
+    allocator_init(STRAT_FIRST);
+    child_malloc = malloc_first_fit;
+    churn();
+    Block *a = g_free_head, *b = a->next_free, *c = b->next_free;
+    int ok = 1;
+    c->prev_free = a;                         /* back link skips b */
+    size_t bad = mmu_check_heap(0);
+    c->prev_free = b;
+    ok &= caught("asymmetric list link", bad, mmu_check_heap(0));
+    Arena *ar = fl_arena_of(b);
+    unsigned s = fl_seg(ar, b);
+    uint8_t max = ar->fl_seg_max[s];
+    ar->fl_seg_max[s] = 0;                    /* bound below a block it holds */
+    bad = mmu_check_heap(0);
+    ar->fl_seg_max[s] = max;
+    ok &= caught("segment bound too low", bad, mmu_check_heap(0));
+    unsigned k = fl_class(blk_size(b));
+    g_fl_class_count[k]++;
+    bad = mmu_check_heap(0);
+    g_fl_class_count[k]--;
+    ok &= caught("size-class count", bad, mmu_check_heap(0));
+    Block *d = c->next_free;                  /* a c b d: links agree, order does not */
+    a->next_free = c; c->prev_free = a; c->next_free = b;
+    b->prev_free = c; b->next_free = d;
+    if (d) d->prev_free = b;
+    bad = mmu_check_heap(0);
+    a->next_free = b; b->prev_free = a; b->next_free = c;
+    c->prev_free = b; c->next_free = d;
+    if (d) d->prev_free = c;
+    ok &= caught("list out of address order", bad, mmu_check_heap(0));
+    return ok;
+}
+
+static int test_list(void) {
+    printf("TEST 3: Free list: links, order, class counts, segment bounds\n");
+    if (!in_child(list_child)) { printf("  ✗ FAIL: broken list not reported\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int tree_child(void) {
+    allocator_init(STRAT_BEST);
+    child_malloc = malloc_best_fit;
+    churn();
+    Block *r = g_avl_root;
+    int ok = 1;
+    r->avl.h++;
+    size_t bad = mmu_check_heap(0);
+    r->avl.h--;
+    ok &= caught("wrong height", bad, mmu_check_heap(0));
+    Block *l = r->avl.l;
+    r->avl.l = r->avl.r;                      /* mirror the root: keys out of order */
+    r->avl.r = l;
+    bad = mmu_check_heap(0);
+    r->avl.r = r->avl.l;
+    r->avl.l = l;
+    ok &= caught("keys out of order", bad, mmu_check_heap(0));
+    Block *leaf = r;
+    while (leaf->avl.l) leaf = leaf->avl.l;
+    Block *parent = r;
+    while (parent->avl.l != leaf) parent = parent->avl.l;
+    parent->avl.l = NULL;                     /* a free block no index holds */
+    bad = mmu_check_heap(0);
+    parent->avl.l = leaf;
+    ok &= caught("free block missing from the tree", bad, mmu_check_heap(0));
+    return ok;
+}
+
+static int test_tree(void) {
+    printf("TEST 4: AVL tree: heights, ordering, membership\n");
+    if (!in_child(tree_child)) { printf("  ✗ FAIL: broken tree not reported\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int buddy_child(void) {
+    allocator_init(STRAT_FIRST);
+    void *small = malloc_buddy_alloc(100);
+    void *big = malloc_buddy_alloc(64u << 10);
+    void *mid = malloc_buddy_alloc(16u << 10);
+    my_free(mid);
+    if (mmu_check_heap(1)) return 0;
+    int ok = 1;
+    uint8_t *m = buddy_map_at((uint8_t*)big + 4096);
+    *m = BUDDY_ALLOC(buddy_order0);           /* a head inside an allocated block */
+    size_t bad = mmu_check_heap(0);
+    *m = 0;
+    ok &= caught("allocated blocks overlap", bad, mmu_check_heap(0));
+    size_t o = buddy_order_for(64u << 10), i = ptr_off(big) >> o;
+    uint8_t st = buddy_bins[o].state[i];
+    buddy_bins[o].state[i] = BIN_LINKED | BIN_FREE;   /* both free and allocated */
+    bad = mmu_check_heap(0);
+    buddy_bins[o].state[i] = st;
+    ok &= caught("block both free and allocated", bad, mmu_check_heap(0));
+    BuddyPage *pg = buddy_page_of(small);
+    pg->used++;
+    bad = mmu_check_heap(0);
+    pg->used--;
+    ok &= caught("slab use count", bad, mmu_check_heap(0));
+    my_free(big);
+    my_free(small);
+    return ok && mmu_check_heap(1) == 0;
+}
+
+static int test_buddy(void) {
+    printf("TEST 5: Buddy pool: overlap, double claims, slab pages\n");
+    if (!in_child(buddy_child)) { printf("  ✗ FAIL: broken buddy pool not reported\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main(void) {
+    printf("=== CONSISTENCY CHECK TEST SUITE ===\n\n");
+    int passed = 0, total = 5;
+    passed += test_clean();
+    passed += test_tags();
+    passed += test_list();
+    passed += test_tree();
+    passed += test_buddy();
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}
@@ -13,7 +13,7 @@ extern Block *g_avl_root;
 extern Strategy g_strat;
 extern void *buddy_base;
 extern size_t buddy_top_size;
-extern BuddyNode *buddy_bins[BUDDY_MAX_ORDER+1];
+extern BuddyBin buddy_bins[BUDDY_MAX_ORDER+1];
 
 static void cleanup_arenas(void) {
     Arena *ar = g_arenas;
@@ -26,6 +26,13 @@ static void cleanup_arenas(void) {
     g_free_head = NULL;
     g_nextfit_cursor = NULL;
     g_avl_root = NULL;
+    g_arena_bytes = 0;
+    memset(g_node_arenas, 0, sizeof(g_node_arenas));
+    memset(g_node_avl, 0, sizeof(g_node_avl));
+    g_fl_finger = NULL;
+    memset(g_fl_class_count, 0, sizeof(g_fl_class_count));
+    g_fl_class_mask = 0;
+    g_free_blocks = g_free_bytes = 0;
 }
 
 static void cleanup_buddy(void) {
@@ -35,7 +42,7 @@ static void cleanup_buddy(void) {
         buddy_top_size = 0;
     }
     for (int i = 0; i <= BUDDY_MAX_ORDER; i++) {
-        buddy_bins[i] = NULL;
+        buddy_bins[i].top = 0;
     }
 }
 
@@ -49,6 +56,7 @@ typedef struct {
     const char *name;
     Strategy strategy;
     void* (*malloc_fn)(size_t);
+    size_t (*batch_fn)(size_t, size_t, void **);
 } AllocatorTest;
 
 static void print_header(const char *title) {
@@ -90,8 +98,6 @@ static int test_alignment(AllocatorTest *alloc) {
     int count = sizeof(sizes) / sizeof(sizes[0]);
     
     void *ptrs[10];
-    int is_buddy = (alloc->strategy == STRAT_UNSET);
-    
     for (int i = 0; i < count; i++) {
         ptrs[i] = alloc->malloc_fn(sizes[i]);
         if (!ptrs[i]) {
@@ -100,8 +106,7 @@ static int test_alignment(AllocatorTest *alloc) {
         }
         
         uintptr_t addr = (uintptr_t)ptrs[i];
-        /* Buddy allocator doesn't guarantee alignment due to internal headers */
-        if (!is_buddy && addr % ALIGN != 0) {
+        if (addr % ALIGN != 0) {
             printf("  ✗ FAIL: ptr %p (for %zu bytes) not aligned to %u\n", 
                    ptrs[i], sizes[i], ALIGN);
             return 0;
@@ -303,11 +308,216 @@ static int test_multiple_allocations(AllocatorTest *alloc) {
     return 1;
 }
 
+static int test_batch(AllocatorTest *alloc) {
+    printf("TEST 8: Batch Allocation and Batch Free\n");
+
+    enum { N = 100 };
+    void *ptrs[N];
+    size_t got = alloc->batch_fn(96, N, ptrs);
+    if (got != N) {
+        printf("  ✗ FAIL: batch returned %zu of %d blocks\n", got, N);
+        return 0;
+    }
+    for (int i = 0; i < N; i++) {
+        if ((uintptr_t)ptrs[i] % ALIGN != 0) {
+            printf("  ✗ FAIL: ptr %p not aligned\n", ptrs[i]);
+            return 0;
+        }
+        memset(ptrs[i], i, 96);
+    }
+    for (int i = 0; i < N; i++) {
+        uint8_t *d = ptrs[i];
+        if (d[0] != (uint8_t)i || d[95] != (uint8_t)i) {
+            printf("  ✗ FAIL: batch blocks overlap (block %d)\n", i);
+            return 0;
+        }
+    }
+    printf("  Allocated %d x 96B in one batch: first=%p last=%p\n", N, ptrs[0], ptrs[N-1]);
+
+    /* Free in a scrambled order with a single-object allocation mixed in */
+    void *single = alloc->malloc_fn(300);
+    for (int i = 0; i < N; i += 7) {
+        void *t = ptrs[i]; ptrs[i] = ptrs[N-1-i]; ptrs[N-1-i] = t;
+    }
+    mmu_free_batch(ptrs, N);
+    printf("  Freed %d blocks in one batch\n", N);
+
+    void *big = alloc->malloc_fn(N * 96);
+    if (!big) {
+        printf("  ✗ FAIL: could not allocate %d bytes after batch free\n", N * 96);
+        return 0;
+    }
+    printf("  Reallocated %d bytes at %p\n", N * 96, big);
+    my_free(big);
+    my_free(single);
+
+    /* A count whose total wraps around must be refused, not carved from a small block */
+    if (alloc->batch_fn == mmu_alloc_batch && mmu_alloc_batch(96, SIZE_MAX / 64, ptrs) != 0) {
+        printf("  ✗ FAIL: overflowing batch was not refused\n");
+        return 0;
+    }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_sized_free(AllocatorTest *alloc) {
+    printf("TEST 9: Sized Free\n");
+
+    size_t sizes[] = {1, 24, 100, 256, 1000, 4000, 70000};
+    int count = sizeof(sizes) / sizeof(sizes[0]);
+    void *ptrs[7];
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < count; i++) {
+            ptrs[i] = alloc->malloc_fn(sizes[i]);
+            if (!ptrs[i]) {
+                printf("  ✗ FAIL: allocation of %zu bytes returned NULL\n", sizes[i]);
+                return 0;
+            }
+        }
+        for (int i = count - 1; i >= 0; i--) my_free_sized(ptrs[i], sizes[i]);
+    }
+    printf("  Allocated and size-freed %d blocks x 3 rounds\n", count);
+
+    void *big = alloc->malloc_fn(75000);
+    if (!big) {
+        printf("  ✗ FAIL: space not reclaimed after sized frees\n");
+        return 0;
+    }
+    my_free_sized(big, 75000);
+
+    if (alloc->strategy == STRAT_UNSET) {
+        /* A repeated sized free must not release a buddy block twice */
+        void *twice = alloc->malloc_fn(8192);
+        my_free_sized(twice, 8192);
+        my_free_sized(twice, 8192);
+        void *x = alloc->malloc_fn(8192), *y = alloc->malloc_fn(8192);
+        if (x == y) {
+            printf("  ✗ FAIL: block handed out twice after a repeated sized free\n");
+            return 0;
+        }
+        my_free_sized(x, 8192);
+        my_free_sized(y, 8192);
+    }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_lazy_coalescing(AllocatorTest *alloc) {
+    printf("TEST 10: Deferred Coalescing (quick-lists)\n");
+
+    allocator_set_lazy_coalesce(1);
+    void *p[8];
+    for (int i = 0; i < 8; i++) p[i] = alloc->malloc_fn(64);
+    void *victim = p[3];
+    my_free(p[3]);
+    p[3] = alloc->malloc_fn(64);
+    printf("  freed %p, same-size request got %p\n", victim, p[3]);
+    if (alloc->strategy != STRAT_UNSET && p[3] != victim) {
+        printf("  ✗ FAIL: quick-list did not hand the block straight back\n");
+        allocator_set_lazy_coalesce(0);
+        return 0;
+    }
+
+    /* Free a run of neighbours; a miss must coalesce them for a big request */
+    for (int i = 0; i < 8; i++) my_free(p[i]);
+    void *big = alloc->malloc_fn(8 * 64 + 7 * 16);
+    if (!big) {
+        printf("  ✗ FAIL: allocation after quick-list flush failed\n");
+        allocator_set_lazy_coalesce(0);
+        return 0;
+    }
+    if (alloc->strategy == STRAT_FIRST && big != p[0]) {
+        printf("  ✗ FAIL: neighbours were not coalesced on the miss (%p vs %p)\n", big, p[0]);
+        allocator_set_lazy_coalesce(0);
+        return 0;
+    }
+    printf("  big request after flush = %p\n", big);
+    my_free(big);
+    allocator_set_lazy_coalesce(0);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_realloc_usable(AllocatorTest *alloc) {
+    printf("TEST 11: Realloc and Usable Size (page-map dispatch)\n");
+
+    unsigned char *p = alloc->malloc_fn(100);
+    if (!p || my_usable_size(p) < 100) {
+        printf("  ✗ FAIL: usable size %zu < 100\n", p ? my_usable_size(p) : 0);
+        return 0;
+    }
+    for (int i = 0; i < 100; i++) p[i] = (unsigned char)i;
+
+    size_t sizes[] = {300, 5000, 70000, 40};
+    for (int k = 0; k < 4; k++) {
+        p = my_realloc(p, sizes[k]);
+        if (!p || my_usable_size(p) < sizes[k]) {
+            printf("  ✗ FAIL: realloc to %zu bytes\n", sizes[k]);
+            return 0;
+        }
+        for (int i = 0; i < 40; i++) {
+            if (p[i] != (unsigned char)i) {
+                printf("  ✗ FAIL: contents lost after realloc to %zu\n", sizes[k]);
+                return 0;
+            }
+        }
+        printf("  ✓ realloc %5zu -> %p (usable %zu)\n", sizes[k], (void*)p, my_usable_size(p));
+    }
+    my_free(p);
+
+    /* Pointers no heap owns are ignored rather than misclassified */
+    int on_stack = 0;
+    my_free(&on_stack);
+    if (my_usable_size(&on_stack) != 0) {
+        printf("  ✗ FAIL: foreign pointer reported a usable size\n");
+        return 0;
+    }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+/* Lowest-address free block that fits, by walking the whole list. */
+static Block *first_fit_oracle(size_t need) {
+    need = ALIGN_UP(need, ALIGN);
+    for (Block *b = g_free_head; b; b = b->next_free)
+        if (blk_size(b) >= need) return b;
+    return NULL;
+}
+
+static int test_search_many_holes(AllocatorTest *alloc) {
+    printf("TEST 12: Search over many free blocks\n");
+    enum { N = 20000, BIG = 16 };
+    void **ptrs = malloc(N * sizeof(void*));
+    void *big[BIG];
+    /* Small holes with a rare 1KB one: only the rare holes fit 512B */
+    for (int i = 0; i < N; i++) ptrs[i] = alloc->malloc_fn(i % 500 == 0 ? 1024 : 48);
+    for (int i = 0; i < N; i += 2) my_free(ptrs[i]);
+    for (int round = 0; round < 2; round++) {
+        for (int k = 0; k < BIG; k++) {
+            Block *expect = alloc->strategy == STRAT_FIRST ? first_fit_oracle(512) : NULL;
+            big[k] = alloc->malloc_fn(512);
+            if (!big[k]) { printf("  ✗ FAIL: 512B allocation %d failed\n", k); return 0; }
+            if (expect && big[k] != blk_to_ptr(expect)) {
+                printf("  ✗ FAIL: first fit returned %p, lowest fitting block is %p\n", big[k], blk_to_ptr(expect));
+                return 0;
+            }
+            memset(big[k], k, 512);
+        }
+        for (int k = 0; k < BIG; k++) my_free(big[k]);
+    }
+    printf("  ✓ %d lookups over %d free blocks\n", 2 * BIG, N / 2);
+    for (int i = 1; i < N; i += 2) my_free(ptrs[i]);
+    free(ptrs);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
 static int run_allocator_tests(AllocatorTest *alloc) {
     print_header(alloc->name);
     
     int passed = 0;
-    int total = 7;
+    int total = 12;
     
     if (test_basic_allocations(alloc)) passed++;
     if (test_alignment(alloc)) passed++;
@@ -316,6 +526,11 @@ static int run_allocator_tests(AllocatorTest *alloc) {
     if (test_large_allocation(alloc)) passed++;
     if (test_fragmentation(alloc)) passed++;
     if (test_multiple_allocations(alloc)) passed++;
+    if (test_batch(alloc)) passed++;
+    if (test_sized_free(alloc)) passed++;
+    if (test_lazy_coalescing(alloc)) passed++;
+    if (test_realloc_usable(alloc)) passed++;
+    if (test_search_many_holes(alloc)) passed++;
     
     printf("Results: %d/%d tests passed\n", passed, total);
     
@@ -336,11 +551,11 @@ int main(void) {
     printf("╚═══════════════════════════════════════════════════════════════╝\n");
     
     AllocatorTest allocators[] = {
-        {"FIRST-FIT", STRAT_FIRST, malloc_first_fit},
-        {"NEXT-FIT", STRAT_NEXT, malloc_next_fit},
-        {"BEST-FIT", STRAT_BEST, malloc_best_fit},
-        {"WORST-FIT", STRAT_WORST, malloc_worst_fit},
-        {"BUDDY", STRAT_UNSET, malloc_buddy_alloc},  /* Buddy is independent */
+        {"FIRST-FIT", STRAT_FIRST, malloc_first_fit, mmu_alloc_batch},
+        {"NEXT-FIT", STRAT_NEXT, malloc_next_fit, mmu_alloc_batch},
+        {"BEST-FIT", STRAT_BEST, malloc_best_fit, mmu_alloc_batch},
+        {"WORST-FIT", STRAT_WORST, malloc_worst_fit, mmu_alloc_batch},
+        {"BUDDY", STRAT_UNSET, malloc_buddy_alloc, mmu_buddy_alloc_batch},  /* Buddy is independent */
     };
     
     int num_allocators = sizeof(allocators) / sizeof(allocators[0]);
@@ -0,0 +1,150 @@
+#include "mmu.hpp"
+#include <cstdio>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* C++ front end (mmu.hpp) test suite */
+
+struct alignas(64) Wide {
+    double v[8];
+};
+
+/* Allocated blocks left in the general heap. */
+static size_t live_blocks() {
+    size_t n = 0;
+    for (Arena* ar = g_arenas; ar; ar = ar->next)
+        for (Block* b = arena_first_blk(ar); b; b = blk_next_phys(b)) n += !blk_is_free(b);
+    return n;
+}
+
+static int test_allocator_containers() {
+    printf("TEST 1: mmu::allocator backs vector, map and unordered_map\n");
+    {
+        std::vector<int, mmu::allocator<int>> v;
+        for (int i = 0; i < 100000; i++) v.push_back(i);
+        std::map<int, int, std::less<int>, mmu::allocator<std::pair<const int, int>>> m;
+        std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                           mmu::allocator<std::pair<const int, int>>> u;
+        for (int i = 0; i < 20000; i++) { m[i] = i * 2; u[i] = i * 3; }
+        for (int i = 0; i < 20000; i += 2) { m.erase(i); u.erase(i); }
+        for (int i = 0; i < 100000; i++)
+            if (v[i] != i) { printf("  ✗ FAIL: vector element %d\n", i); return 0; }
+        for (int i = 1; i < 20000; i += 2)
+            if (m[i] != i * 2 || u[i] != i * 3) { printf("  ✗ FAIL: map element %d\n", i); return 0; }
+        if (m.size() != 10000 || u.size() != 10000) { printf("  ✗ FAIL: erase lost track\n"); return 0; }
+    }
+    if (live_blocks()) { printf("  ✗ FAIL: %zu blocks live after the containers died\n", live_blocks()); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_rebind_and_alignment() {
+    printf("TEST 2: Rebinding, equality and over-aligned types\n");
+    mmu::allocator<int> a;
+    mmu::allocator<Wide> w(a);
+    if (!(a == mmu::allocator<int>(w))) { printf("  ✗ FAIL: rebound allocators compare unequal\n"); return 0; }
+    std::vector<Wide*> ps;
+    for (int i = 0; i < 1000; i++) {
+        Wide* p = w.allocate(1 + i % 7);
+        if ((uintptr_t)p % alignof(Wide)) { printf("  ✗ FAIL: %p not 64-byte aligned\n", (void*)p); return 0; }
+        p->v[0] = i;
+        ps.push_back(p);
+    }
+    for (int i = 0; i < 1000; i++) {
+        if (ps[i]->v[0] != i) { printf("  ✗ FAIL: object %d corrupted\n", i); return 0; }
+        w.deallocate(ps[i], 1 + i % 7);
+    }
+    try {
+        (void)a.allocate(std::numeric_limits<std::size_t>::max() / 2);
+        printf("  ✗ FAIL: oversized request did not throw\n");
+        return 0;
+    } catch (const std::bad_alloc&) {}
+    if (live_blocks()) { printf("  ✗ FAIL: over-aligned blocks leaked\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_heap_resource() {
+    printf("TEST 3: heap_resource with pmr containers, sized frees into the buddy allocator\n");
+    {
+        std::pmr::vector<std::pmr::string> v(mmu::resource<mmu::best_fit>());
+        for (int i = 0; i < 5000; i++) v.emplace_back(std::to_string(i) + " a string too long for SSO");
+        for (int i = 0; i < 5000; i++)
+            if (v[i].compare(0, std::to_string(i).size(), std::to_string(i)) != 0) {
+                printf("  ✗ FAIL: string %d\n", i);
+                return 0;
+            }
+        mmu::heap_resource<mmu::best_fit> other;
+        if (!mmu::resource<mmu::best_fit>()->is_equal(other) || other.is_equal(*mmu::resource<mmu::buddy>())) {
+            printf("  ✗ FAIL: is_equal\n");
+            return 0;
+        }
+    }
+    if (live_blocks()) { printf("  ✗ FAIL: strings leaked\n"); return 0; }
+    std::pmr::memory_resource* b = mmu::resource<mmu::buddy>();
+    void* p[64];
+    for (int i = 0; i < 64; i++) p[i] = b->allocate(24 + 100 * (size_t)i, i % 4 ? 16 : 256);
+    for (int i = 0; i < 64; i++) {
+        if ((uintptr_t)p[i] % (i % 4 ? 16 : 256)) { printf("  ✗ FAIL: buddy block misaligned\n"); return 0; }
+        b->deallocate(p[i], 24 + 100 * (size_t)i, i % 4 ? 16 : 256);
+    }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_pool_resource() {
+    printf("TEST 4: pool_resource serves small sizes from pools, large ones upstream\n");
+    mmu::pool_resource pool(mmu::resource<mmu::best_fit>());
+    std::pmr::map<int, std::pmr::vector<int>> m(&pool);
+    for (int i = 0; i < 4000; i++) m[i].assign((size_t)(i % 600), i);
+    for (int i = 0; i < 4000; i += 3) m.erase(i);
+    for (auto& kv : m)
+        for (int x : kv.second)
+            if (x != kv.first) { printf("  ✗ FAIL: element of %d corrupted\n", kv.first); return 0; }
+    void* a = pool.allocate(40);
+    if (pm_kind(pagemap_get(a)) != OWN_POOL) { printf("  ✗ FAIL: 40 bytes not pooled\n"); return 0; }
+    void* big = pool.allocate(5000);
+    if (pm_kind(pagemap_get(big)) != OWN_ARENA) { printf("  ✗ FAIL: 5000 bytes not sent upstream\n"); return 0; }
+    pool.deallocate(big, 5000);
+    pool.deallocate(a, 40);
+    void* c = pool.allocate(33);
+    if (c != a) { printf("  ✗ FAIL: freed 48-byte slot not reused\n"); return 0; }
+    pool.deallocate(c, 33);
+    m.clear();
+    if (live_blocks()) { printf("  ✗ FAIL: upstream blocks leaked\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_region_resource() {
+    printf("TEST 5: region_resource is monotonic and released in bulk\n");
+    mmu::region_resource region(0, true);
+    for (int round = 0; round < 3; round++) {
+        {
+            std::pmr::unordered_map<int, std::pmr::string> u(&region);
+            for (int i = 0; i < 10000; i++) u.emplace(i, std::pmr::string(40, (char)('a' + i % 26)));
+            for (int i = 0; i < 10000; i++)
+                if (u.at(i)[39] != (char)('a' + i % 26)) { printf("  ✗ FAIL: value %d\n", i); return 0; }
+        }
+        void* w = region.allocate(100, 128);
+        if ((uintptr_t)w % 128) { printf("  ✗ FAIL: over-aligned region block\n"); return 0; }
+        region.release();
+    }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main() {
+    printf("=== C++ FRONT END TEST SUITE ===\n\n");
+    int passed = 0, total = 5;
+    passed += test_allocator_containers();
+    passed += test_rebind_and_alignment();
+    passed += test_heap_resource();
+    passed += test_pool_resource();
+    passed += test_region_resource();
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}
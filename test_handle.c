@@ -0,0 +1,151 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Relocatable handles (mmu_handle_*) and online compaction (mmu_compact) test suite */
+
+static void fill(MmuHandle h, size_t size) {
+    uint8_t *p = mmu_handle_deref(h);
+    for (size_t i = 0; i < size; i++) p[i] = (uint8_t)(h * 31 + i);
+}
+
+static int check(MmuHandle h, size_t size) {
+    uint8_t *p = mmu_handle_deref(h);
+    for (size_t i = 0; i < size; i++)
+        if (p[i] != (uint8_t)(h * 31 + i)) return 0;
+    return 1;
+}
+
+static int count_arenas(void) {
+    int n = 0;
+    for (Arena *ar = g_arenas; ar; ar = ar->next) n++;
+    return n;
+}
+
+/* Free blocks in the heap; 0 if any boundary tag is inconsistent. */
+static size_t walk_free_blocks(void) {
+    size_t nfree = 0;
+    for (Arena *ar = g_arenas; ar; ar = ar->next) {
+        size_t prev = 0;
+        for (Block *b = (Block*)((uint8_t*)ar + ARENA_HDR_SZ); b; b = blk_next_phys(b)) {
+            if (b->prev_size != prev) return 0;
+            if (blk_is_free(b)) nfree++;
+            prev = blk_size(b);
+        }
+    }
+    return nfree;
+}
+
+static int test_basic(void) {
+    printf("TEST 1: Handle alloc, deref and free\n");
+    MmuHandle a = mmu_handle_alloc(100), b = mmu_handle_alloc(3000);
+    if (!a || !b || a == b) { printf("  ✗ FAIL: bad handles %u %u\n", a, b); return 0; }
+    if ((uintptr_t)mmu_handle_deref(a) % ALIGN || (uintptr_t)mmu_handle_deref(b) % ALIGN) {
+        printf("  ✗ FAIL: objects not aligned\n");
+        return 0;
+    }
+    fill(a, 100); fill(b, 3000);
+    mmu_handle_free(a);
+    MmuHandle c = mmu_handle_alloc(50);
+    if (c != a) { printf("  ✗ FAIL: freed slot %u not reused (got %u)\n", a, c); return 0; }
+    if (!check(b, 3000)) { printf("  ✗ FAIL: object corrupted\n"); return 0; }
+    if (mmu_handle_alloc(0) != 0) { printf("  ✗ FAIL: zero-size allocation returned a handle\n"); return 0; }
+    mmu_handle_free(b); mmu_handle_free(c); mmu_handle_free(0);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_full_pass(void) {
+    printf("TEST 2: A full pass slides handles down and merges the holes\n");
+    enum { N = 4000 };
+    static MmuHandle hs[N];
+    static size_t sz[N];
+    srand(7);
+    void *pin = malloc_best_fit(64);       /* an immovable block ahead of the handles */
+    for (int i = 0; i < N; i++) {
+        sz[i] = 16 + (size_t)(rand() % 500);
+        hs[i] = mmu_handle_alloc(sz[i]);
+        if (!hs[i]) { printf("  ✗ FAIL: allocation %d failed\n", i); return 0; }
+        fill(hs[i], sz[i]);
+    }
+    for (int i = 0; i < N; i += 2) { mmu_handle_free(hs[i]); hs[i] = 0; }
+    size_t before = walk_free_blocks();
+    if (mmu_compact(0) != 1) { printf("  ✗ FAIL: unbudgeted pass did not finish\n"); return 0; }
+    size_t after = walk_free_blocks();
+    printf("  free blocks: %zu -> %zu\n", before, after);
+    if (!after || after > (size_t)count_arenas()) { printf("  ✗ FAIL: holes left behind\n"); return 0; }
+    for (int i = 1; i < N; i += 2)
+        if (!check(hs[i], sz[i])) { printf("  ✗ FAIL: handle %u corrupted by a move\n", hs[i]); return 0; }
+    for (int i = 1; i < N; i += 2) mmu_handle_free(hs[i]);
+    my_free(pin);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_incremental(void) {
+    printf("TEST 3: Budgeted passes resume across heap activity\n");
+    enum { N = 20000 };
+    static MmuHandle hs[N];
+    static size_t sz[N];
+    static void *plain[N];
+    srand(3);
+    for (int i = 0; i < N; i++) {
+        sz[i] = 16 + (size_t)(rand() % 200);
+        hs[i] = mmu_handle_alloc(sz[i]);
+        plain[i] = (i % 3 == 0) ? malloc_best_fit(48) : NULL;
+        fill(hs[i], sz[i]);
+    }
+    for (int i = 0; i < N; i++) if (rand() % 2) { mmu_handle_free(hs[i]); hs[i] = 0; }
+
+    int calls = 0, done = 0;
+    while (!done) {
+        done = mmu_compact(20);
+        calls++;
+        /* Frees between calls merge blocks, possibly the one the pass paused on. */
+        for (int k = 0; k < 50; k++) {
+            int i = rand() % N;
+            if (plain[i]) { my_free(plain[i]); plain[i] = NULL; }
+            if (hs[i] && rand() % 4 == 0) { mmu_handle_free(hs[i]); hs[i] = 0; }
+        }
+        if (!walk_free_blocks()) { printf("  ✗ FAIL: boundary tags broken after call %d\n", calls); return 0; }
+    }
+    printf("  pass finished after %d calls\n", calls);
+    if (calls < 2) { printf("  ✗ FAIL: the budget never paused the pass\n"); return 0; }
+    for (int i = 0; i < N; i++)
+        if (hs[i] && !check(hs[i], sz[i])) { printf("  ✗ FAIL: handle %u corrupted\n", hs[i]); return 0; }
+    for (int i = 0; i < N; i++) { mmu_handle_free(hs[i]); my_free(plain[i]); }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_release(void) {
+    printf("TEST 4: Wholly free arenas are unmapped\n");
+    enum { N = 3000 };
+    static MmuHandle hs[N];
+    for (int i = 0; i < N; i++) hs[i] = mmu_handle_alloc(4000);
+    int grown = count_arenas();
+    for (int i = 0; i < N; i++) mmu_handle_free(hs[i]);
+    while (!mmu_compact(0)) {}
+    printf("  arenas: %d -> %d\n", grown, count_arenas());
+    if (grown < 2 || count_arenas() != 1) { printf("  ✗ FAIL: free arenas kept\n"); return 0; }
+    MmuHandle h = mmu_handle_alloc(1 << 20);
+    if (!h) { printf("  ✗ FAIL: heap unusable after release\n"); return 0; }
+    fill(h, 1 << 20);
+    if (!check(h, 1 << 20)) { printf("  ✗ FAIL: object corrupted\n"); return 0; }
+    mmu_handle_free(h);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main(void) {
+    printf("=== RELOCATABLE HANDLE TEST SUITE ===\n\n");
+    allocator_init(STRAT_BEST);
+    int passed = 0, total = 4;
+    passed += test_basic();
+    passed += test_full_pass();
+    passed += test_incremental();
+    passed += test_release();
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}
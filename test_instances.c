@@ -0,0 +1,164 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* Specialised instances (MMU_SPECIALIZE, mmu_<name>_*) test suite.
+ * A process locks one strategy, so each case runs in forked children. */
+
+typedef struct {
+    const char *name;
+    Strategy strategy;
+    int quick;
+    void (*init)(void);
+    void* (*malloc_fn)(size_t);
+    void (*free_fn)(void *);
+    void* (*flavor)(size_t);
+} Instance;
+
+static const Instance instances[] = {
+    {"first",       STRAT_FIRST, 0, mmu_first_init, mmu_first_malloc, mmu_first_free, malloc_first_fit},
+    {"next",        STRAT_NEXT,  0, mmu_next_init,  mmu_next_malloc,  mmu_next_free,  malloc_next_fit},
+    {"best",        STRAT_BEST,  0, mmu_best_init,  mmu_best_malloc,  mmu_best_free,  malloc_best_fit},
+    {"worst",       STRAT_WORST, 0, mmu_worst_init, mmu_worst_malloc, mmu_worst_free, malloc_worst_fit},
+    {"first_quick", STRAT_FIRST, 1, mmu_first_quick_init, mmu_first_quick_malloc, mmu_first_quick_free, malloc_first_fit},
+    {"best_quick",  STRAT_BEST,  1, mmu_best_quick_init,  mmu_best_quick_malloc,  mmu_best_quick_free,  malloc_best_fit},
+};
+#define NUM_INSTANCES (int)(sizeof(instances) / sizeof(instances[0]))
+
+/* Hash of every address a random trace is given. Forked children start from
+ * the same heap, so equal placement decisions give equal hashes. */
+static uint64_t trace_hash(const Instance *in, int specialised) {
+    enum { SLOTS = 2000 };
+    static void *ptrs[SLOTS];
+    uint64_t h = 1469598103934665603ull;
+    if (specialised) in->init();
+    else { allocator_init(in->strategy); allocator_set_lazy_coalesce(in->quick); }
+    srand(9);
+    for (int k = 0; k < 60000; k++) {
+        int i = rand() % SLOTS;
+        size_t size = 16 + (size_t)(rand() % 64) * (rand() % 8 ? 8 : 256);
+        if (ptrs[i]) { if (specialised) in->free_fn(ptrs[i]); else my_free(ptrs[i]); }
+        ptrs[i] = specialised ? in->malloc_fn(size) : in->flavor(size);
+        if (!ptrs[i]) return 0;
+        memset(ptrs[i], i, 16);
+        h = (h ^ (uint64_t)(uintptr_t)ptrs[i]) * 1099511628211ull;
+    }
+    for (int i = 0; i < SLOTS; i++)
+        if (ptrs[i] && *(uint8_t*)ptrs[i] != (uint8_t)i) return 0;
+    return h;
+}
+
+static uint64_t run_hash(const Instance *in, int specialised) {
+    int fd[2];
+    uint64_t h = 0;
+    if (pipe(fd) != 0) return 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fd[0]);
+        h = trace_hash(in, specialised);
+        if (write(fd[1], &h, sizeof(h)) != sizeof(h)) _exit(1);
+        _exit(0);
+    }
+    close(fd[1]);
+    if (read(fd[0], &h, sizeof(h)) != sizeof(h)) h = 0;
+    close(fd[0]);
+    waitpid(pid, NULL, 0);
+    return h;
+}
+
+static int test_same_placement(void) {
+    printf("TEST 1: Each instance places blocks exactly like its malloc_* flavor\n");
+    for (int i = 0; i < NUM_INSTANCES; i++) {
+        uint64_t a = run_hash(&instances[i], 0), b = run_hash(&instances[i], 1);
+        if (!a || a != b) { printf("  ✗ FAIL: %s diverged (%llx vs %llx)\n", instances[i].name,
+                                   (unsigned long long)a, (unsigned long long)b); return 0; }
+        printf("  ✓ %s\n", instances[i].name);
+    }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+/* Runs fn in a child; 1 if it exited with status 0. */
+static int in_child(int (*fn)(void)) {
+    pid_t pid = fork();
+    if (pid == 0) _exit(fn() ? 0 : 1);
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static int interop_child(void) {
+    mmu_best_init();
+    char *p = mmu_best_malloc(100);
+    strcpy(p, "instance");
+    if (my_usable_size(p) < 100) return 0;
+    p = my_realloc(p, 40000);
+    if (!p || strcmp(p, "instance") != 0) return 0;
+    my_free(p);
+    void *q = malloc_best_fit(300);
+    mmu_best_free(q);
+    mmu_best_free(NULL);
+    return g_free_blocks == 1;
+}
+
+static int test_interop(void) {
+    printf("TEST 2: Instance pointers work with my_free, my_realloc and my_usable_size\n");
+    if (!in_child(interop_child)) { printf("  ✗ FAIL: pointers not interchangeable\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int quick_child(void) {
+    mmu_first_quick_init();
+    void *a = mmu_first_quick_malloc(64), *b = mmu_first_quick_malloc(64);
+    mmu_first_quick_free(a);
+    size_t before = g_free_blocks;
+    void *c = mmu_first_quick_malloc(64);
+    if (c != a || g_free_blocks != before) return 0;
+    mmu_first_quick_free(b);
+    mmu_first_quick_free(c);
+    allocator_set_lazy_coalesce(0);         /* flush */
+    return g_free_blocks == 1;
+}
+
+static int test_quick_instance(void) {
+    printf("TEST 3: A quick-list instance reuses parked blocks without the index\n");
+    if (!in_child(quick_child)) { printf("  ✗ FAIL: parked block not reused\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int mix_child(void) {
+    fclose(stderr);
+    mmu_best_init();
+    malloc_first_fit(32);                   /* aborts */
+    return 1;
+}
+
+static int test_mix_rejected(void) {
+    printf("TEST 4: init refuses a second strategy\n");
+    pid_t pid = fork();
+    if (pid == 0) _exit(mix_child() ? 0 : 1);
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFSIGNALED(status)) { printf("  ✗ FAIL: mixed strategies accepted\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main(void) {
+    printf("=== SPECIALISED INSTANCE TEST SUITE ===\n\n");
+    fflush(stdout);
+    int passed = 0, total = 4;
+    passed += test_same_placement();
+    fflush(stdout);
+    passed += test_interop();
+    passed += test_quick_instance();
+    fflush(stdout);
+    passed += test_mix_rejected();
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#ifndef MMU_INSTRUMENT
+#define MMU_INSTRUMENT
+#endif
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Instrumentation (MMU_INSTRUMENT, mmu_stats_*) test suite */
+
+static int test_counts(void) {
+    printf("TEST 1: Each entry point and phase counts its calls\n");
+    enum { N = 1000 };
+    static void *ptrs[N];
+    allocator_init(STRAT_BEST);
+    mmu_stats_reset();
+    for (int i = 0; i < N; i++) ptrs[i] = malloc_best_fit(32 + (size_t)(i % 50) * 16);
+    for (int i = 0; i < N; i += 2) my_free(ptrs[i]);
+    for (int i = 1; i < N; i += 2) my_free_sized(ptrs[i], 32 + (size_t)(i % 50) * 16);
+    void *b = malloc_buddy_alloc(100);
+    void *r = my_realloc(NULL, 64);
+    my_free(b);
+    my_free(r);
+    struct { MmuProbe p; uint64_t want; } cases[] = {
+        {MMU_P_malloc, N},              /* my_realloc(NULL) counts as realloc */
+        {MMU_P_free, N / 2 + 2},
+        {MMU_P_free_sized, N / 2},
+        {MMU_P_realloc, 1},
+        {MMU_P_buddy_alloc, 1},
+        {MMU_P_index_find, N + 1},
+        {MMU_P_split, N + 1},
+        {MMU_P_coalesce, N + 1},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        uint64_t got = mmu_stats_count(cases[i].p);
+        if (got != cases[i].want) {
+            printf("  ✗ FAIL: %s counted %llu, expected %llu\n", mmu_probe_names[cases[i].p],
+                   (unsigned long long)got, (unsigned long long)cases[i].want);
+            return 0;
+        }
+    }
+    if (mmu_stats_count(MMU_P_pool_alloc) || mmu_stats_count(MMU_P_compact)) {
+        printf("  ✗ FAIL: probes fired for unused entry points\n");
+        return 0;
+    }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_percentiles(void) {
+    printf("TEST 2: Percentiles are ordered and bounded by the maximum\n");
+    MmuPool *pool = mmu_pool_create(48, 0);
+    void *objs[4096];
+    mmu_stats_reset();
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 4096; i++) objs[i] = mmu_pool_alloc(pool);
+        for (int i = 0; i < 4096; i++) mmu_pool_free(pool, objs[i]);
+    }
+    for (MmuProbe p = MMU_P_pool_alloc; p <= MMU_P_pool_free; p = (MmuProbe)(p + 1)) {
+        uint64_t p50 = mmu_stats_percentile(p, 0.5), p99 = mmu_stats_percentile(p, 0.99);
+        uint64_t max = mmu_stats_percentile(p, 1.0);
+        printf("  %-10s p50 %llu  p99 %llu  max %llu ticks\n", mmu_probe_names[p],
+               (unsigned long long)p50, (unsigned long long)p99, (unsigned long long)max);
+        if (mmu_stats_count(p) != 20 * 4096) { printf("  ✗ FAIL: %s miscounted\n", mmu_probe_names[p]); return 0; }
+        if (!(p50 <= p99 && p99 <= max) || max != g_hist[p].max) {
+            printf("  ✗ FAIL: %s percentiles out of order\n", mmu_probe_names[p]);
+            return 0;
+        }
+    }
+    /* Bucket bounds are exact below 16 and within 1/16 above */
+    for (uint64_t v = 1; v < ((uint64_t)1 << 40); v = v * 3 + 1) {
+        unsigned i = hist_bucket(v);
+        if (hist_lower(i) > v || hist_lower(i + 1) <= v || (v >= HIST_SUB && hist_lower(i + 1) - hist_lower(i) > v / HIST_SUB)) {
+            printf("  ✗ FAIL: %llu in bucket %u [%llu, %llu)\n", (unsigned long long)v, i,
+                   (unsigned long long)hist_lower(i), (unsigned long long)hist_lower(i + 1));
+            return 0;
+        }
+    }
+    mmu_pool_destroy(pool);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_arena_growth(void) {
+    printf("TEST 3: Heap growth shows up as arena_map inside malloc\n");
+    mmu_stats_reset();
+    void *big = malloc_best_fit(8u << 20);
+    if (!big || mmu_stats_count(MMU_P_arena_map) != 1) {
+        printf("  ✗ FAIL: arena_map counted %llu\n", (unsigned long long)mmu_stats_count(MMU_P_arena_map));
+        return 0;
+    }
+    if (g_hist[MMU_P_malloc].max < g_hist[MMU_P_arena_map].max) {
+        printf("  ✗ FAIL: malloc shorter than the mmap it contains\n");
+        return 0;
+    }
+    my_free(big);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_dump_and_reset(void) {
+    printf("TEST 4: mmu_stats_dump lists the probes that fired; reset clears them\n");
+    char buf[4096] = {0};
+    FILE *f = fmemopen(buf, sizeof(buf) - 1, "w");
+    mmu_stats_dump(f);
+    fclose(f);
+    printf("%s", buf);
+    if (!strstr(buf, "malloc") || !strstr(buf, "arena_map") || strstr(buf, "handle_alloc")) {
+        printf("  ✗ FAIL: dump does not match the probes that fired\n");
+        return 0;
+    }
+    mmu_stats_reset();
+    for (int p = 0; p < MMU_NPROBES; p++)
+        if (mmu_stats_count((MmuProbe)p) || mmu_stats_percentile((MmuProbe)p, 0.5)) {
+            printf("  ✗ FAIL: %s survived the reset\n", mmu_probe_names[p]);
+            return 0;
+        }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main(void) {
+    printf("=== INSTRUMENTATION TEST SUITE ===\n\n");
+    int passed = 0, total = 4;
+    passed += test_counts();
+    passed += test_percentiles();
+    passed += test_arena_growth();
+    passed += test_dump_and_reset();
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Scan kernel (kern_find_ge) test suite */
+
+static const char *isas[] = {"scalar", "sse4.2", "avx2"};
+
+static size_t ref_find_ge(const uint8_t *a, size_t n, unsigned v) {
+    for (size_t i = 0; i < n; i++)
+        if (a[i] >= v) return i;
+    return n;
+}
+
+static int test_dispatch(void) {
+    printf("TEST 1: Runtime selection\n");
+    printf("  selected at startup: %s\n", mmu_kern_name());
+    if (!mmu_kern_select("scalar") || strcmp(mmu_kern_name(), "scalar") != 0) {
+        printf("  ✗ FAIL: scalar kernels must always be available\n");
+        return 0;
+    }
+    if (mmu_kern_select("neon")) { printf("  ✗ FAIL: unknown instruction set accepted\n"); return 0; }
+    if (strcmp(mmu_kern_name(), "scalar") != 0) { printf("  ✗ FAIL: a failed selection changed the kernels\n"); return 0; }
+    mmu_kern_select(NULL);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_find_ge(void) {
+    printf("TEST 2: kern_find_ge matches a byte-by-byte scan\n");
+    static uint8_t a[300];
+    srand(2);
+    for (int i = 0; i < 3; i++) {
+        if (!mmu_kern_select(isas[i])) { printf("  - %s not supported\n", isas[i]); continue; }
+        for (int k = 0; k < 20000; k++) {
+            size_t off = (size_t)(rand() % 16), n = (size_t)(rand() % 280);
+            unsigned v = (unsigned)(rand() % 128);
+            for (size_t j = 0; j < sizeof(a); j++) a[j] = (uint8_t)(rand() % 128);
+            /* Mostly below v, so the hit lands anywhere, tails included */
+            for (size_t j = 0; j < sizeof(a); j++) if (rand() % 64) a[j] = (uint8_t)(v ? rand() % v : 0);
+            size_t got = kern_find_ge(a + off, n, v), want = ref_find_ge(a + off, n, v);
+            if (got != want) {
+                printf("  ✗ FAIL: %s: n %zu v %u -> %zu, expected %zu\n", isas[i], n, v, got, want);
+                return 0;
+            }
+        }
+        printf("  ✓ %s\n", isas[i]);
+    }
+    mmu_kern_select(NULL);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_first_fit_per_isa(void) {
+    printf("TEST 3: First fit picks the same blocks under every kernel\n");
+    enum { N = 8000 };
+    static void *ptrs[N];
+    allocator_init(STRAT_FIRST);
+    for (int i = 0; i < N; i++) ptrs[i] = malloc_first_fit(i % 300 == 0 ? 2048 : 48);
+    for (int i = 0; i < N; i += 2) my_free(ptrs[i]);
+    void *first[3] = {NULL, NULL, NULL};
+    for (int i = 0; i < 3; i++) {
+        if (!mmu_kern_select(isas[i])) continue;
+        void *p = malloc_first_fit(1024);
+        first[i] = p;
+        my_free(p);
+        if (first[0] && p != first[0]) { printf("  ✗ FAIL: %s picked %p, scalar %p\n", isas[i], p, first[0]); return 0; }
+    }
+    mmu_kern_select(NULL);
+    for (int i = 1; i < N; i += 2) my_free(ptrs[i]);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main(void) {
+    printf("=== SCAN KERNEL TEST SUITE ===\n\n");
+    int passed = 0, total = 3;
+    passed += test_dispatch();
+    passed += test_find_ge();
+    passed += test_first_fit_per_isa();
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/* NUMA placement (mmu_numa_*) test suite. Runs on one node: MMU_NUMA_NODES
+ * fakes the topology. A process locks one strategy, so each case forks. */
+
+static int in_child(int (*fn)(void)) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) _exit(fn() ? 0 : 1);
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static int count_arenas(void) {
+    int n = 0;
+    for (Arena *ar = g_arenas; ar; ar = ar->next) n++;
+    return n;
+}
+
+static int single_child(void) {
+    unsetenv("MMU_NUMA_NODES");
+    unsigned n = mmu_numa_init();
+    printf("  nodes online: %u, placement %s\n", g_numa_real, n > 1 ? "on" : "off");
+    allocator_init(STRAT_BEST);
+    void *p = malloc_best_fit(5000);
+    if (!p || mmu_numa_node_of(p) != 0 || (n == 1 && mmu_numa_set_node(1))) return 0;
+    my_free(p);
+    return mmu_numa_node_of(&n) == -1;
+}
+
+static int test_single_node(void) {
+    printf("TEST 1: Without a fake topology one node leaves placement off\n");
+    if (!in_child(single_child)) { printf("  ✗ FAIL: single-node fallback\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+/* Per-node working sets: every block must come from its node's arenas, a
+ * free from another node must go back to the owner, and the owner must get
+ * it again without growing the heap. */
+static Strategy child_strategy;
+static void* (*child_malloc)(size_t);
+
+static int per_node_child(void) {
+    enum { NODES = 4, PER = 3000 };
+    static void *ptrs[NODES][PER];
+    setenv("MMU_NUMA_NODES", "4", 1);
+    if (mmu_numa_init() != NODES) return 0;
+    allocator_init(child_strategy);
+    for (int round = 0; round < 3; round++)
+        for (int node = 0; node < NODES; node++) {
+            mmu_numa_set_node(node);
+            for (int i = round; i < PER; i += 3) {
+                ptrs[node][i] = child_malloc(64 + (size_t)((i * 7 + node) % 40) * 32);
+                if (mmu_numa_node_of(ptrs[node][i]) != node) {
+                    printf("  node %d got a block of node %d\n", node, mmu_numa_node_of(ptrs[node][i]));
+                    return 0;
+                }
+                memset(ptrs[node][i], node, 64);
+            }
+        }
+    int arenas = count_arenas();
+    mmu_numa_set_node(0);                    /* node 0 frees node 2's blocks */
+    for (int i = 0; i < PER; i++) my_free(ptrs[2][i]);
+    for (int i = 0; i < PER; i += 2) {       /* node 0 must not take them */
+        void *p = child_malloc(64);
+        if (mmu_numa_node_of(p) != 0) { printf("  node 0 reused remote memory\n"); return 0; }
+        my_free(p);
+    }
+    mmu_numa_set_node(2);
+    for (int i = 0; i < PER; i++) {
+        ptrs[2][i] = child_malloc(64 + (size_t)((i * 7 + 2) % 40) * 32);
+        if (mmu_numa_node_of(ptrs[2][i]) != 2) return 0;
+    }
+    if (count_arenas() != arenas) { printf("  %d arenas, was %d\n", count_arenas(), arenas); return 0; }
+    for (int node = 0; node < NODES; node++)
+        for (int i = 0; i < PER; i++) {
+            if (node != 2 && *(uint8_t*)ptrs[node][i] != node) return 0;
+            my_free(ptrs[node][i]);
+        }
+    quick_flush();                           /* STRAT_AUTO parks frees */
+    return g_free_blocks == (size_t)arenas;
+}
+
+static int test_per_node(int num, const char *name, Strategy s, void* (*fn)(size_t)) {
+    printf("TEST %d: %s keeps each node's blocks on that node\n", num, name);
+    child_strategy = s;
+    child_malloc = fn;
+    if (!in_child(per_node_child)) { printf("  ✗ FAIL: %s crossed nodes\n", name); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int mbind_child(void) {
+    setenv("MMU_NUMA_NODES", "2", 1);
+    mmu_numa_init();
+    allocator_init(STRAT_FIRST);
+    mmu_numa_set_node(0);
+    void *a = malloc_first_fit(2u << 20);
+    mmu_numa_set_node(1);
+    void *b = malloc_first_fit(2u << 20);
+    int pa = -1, pb = -1;
+    unsigned long ma[(MMU_NUMA_MAX_NODES + 63) / 64] = {0}, mb[(MMU_NUMA_MAX_NODES + 63) / 64] = {0};
+    /* MPOL_F_ADDR: the policy covering the address */
+    if (syscall(SYS_get_mempolicy, &pa, ma, (unsigned long)MMU_NUMA_MAX_NODES + 1, a, 2ul) != 0 ||
+        syscall(SYS_get_mempolicy, &pb, mb, (unsigned long)MMU_NUMA_MAX_NODES + 1, b, 2ul) != 0) {
+        printf("  - get_mempolicy unavailable\n");
+        return 1;
+    }
+    printf("  node 0 arena: policy %d mask %lx; fake node 1 arena: policy %d\n", pa, ma[0], pb);
+    memset(a, 1, 2u << 20);
+    memset(b, 1, 2u << 20);
+    return pa == MMU_MPOL_PREFERRED && ma[0] == 1 && pb == 0;
+}
+
+static int test_mbind(void) {
+    printf("TEST 5: Arenas of real nodes are mbind()ed; fake nodes fall back to first touch\n");
+    if (!in_child(mbind_child)) { printf("  ✗ FAIL: memory policy not as expected\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main(void) {
+    printf("=== NUMA PLACEMENT TEST SUITE ===\n\n");
+    int passed = 0, total = 5;
+    passed += test_single_node();
+    passed += test_per_node(2, "Best fit (per-node trees)", STRAT_BEST, malloc_best_fit);
+    passed += test_per_node(3, "First fit (per-node arena lists)", STRAT_FIRST, malloc_first_fit);
+    passed += test_per_node(4, "The adaptive strategy", STRAT_AUTO, malloc_auto_fit);
+    passed += test_mbind();
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}
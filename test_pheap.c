@@ -0,0 +1,232 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+/* File-backed persistent heap (mmu_pheap_*) and shared heap (mmu_shheap_*) test suite */
+
+typedef struct Node {
+    struct Node *next;      /* raw pointer: valid because the base is fixed */
+    uint64_t value;
+    char label[32];
+} Node;
+
+static char path[] = "/tmp/mmu_pheap_XXXXXX";
+
+static int build_list(MmuPHeap *h, int n) {
+    Node *head = NULL;
+    for (int i = n - 1; i >= 0; i--) {
+        Node *nd = mmu_pheap_alloc(h, sizeof(Node));
+        if (!nd) return 0;
+        nd->next = head;
+        nd->value = (uint64_t)i * 7;
+        snprintf(nd->label, sizeof(nd->label), "node-%d", i);
+        head = nd;
+    }
+    mmu_pheap_set_root(h, head);
+    return 1;
+}
+
+static int check_list(MmuPHeap *h, int n) {
+    Node *nd = mmu_pheap_root(h);
+    char want[32];
+    for (int i = 0; i < n; i++, nd = nd->next) {
+        snprintf(want, sizeof(want), "node-%d", i);
+        if (!nd || nd->value != (uint64_t)i * 7 || strcmp(nd->label, want) != 0) return 0;
+    }
+    return nd == NULL;
+}
+
+static int test_reopen(void) {
+    printf("TEST 1: Pointer-rich data survives close and reopen\n");
+    MmuPHeap *h = mmu_pheap_open(path, 4 << 20, NULL);
+    if (!h) { perror("  ✗ FAIL: mmu_pheap_open"); return 0; }
+    void *base = h;
+    if (!build_list(h, 10000)) { printf("  ✗ FAIL: allocation failed\n"); return 0; }
+    mmu_pheap_close(h);
+
+    h = mmu_pheap_open(path, 0, NULL);
+    if (!h || (void*)h != base) { printf("  ✗ FAIL: not remapped at the recorded base\n"); return 0; }
+    if (!check_list(h, 10000)) { printf("  ✗ FAIL: list corrupted after reopen\n"); return 0; }
+    printf("  ✓ 10000 linked nodes intact at base %p\n", base);
+    mmu_pheap_close(h);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_free_and_coalesce(void) {
+    printf("TEST 2: Free, coalescing and my_free dispatch\n");
+    MmuPHeap *h = mmu_pheap_open(path, 0, NULL);
+    if (!h) { printf("  ✗ FAIL: reopen failed\n"); return 0; }
+    Node *nd = mmu_pheap_root(h);
+    mmu_pheap_set_root(h, NULL);
+    while (nd) { Node *next = nd->next; my_free(nd); nd = next; }
+    if (h->free_head == 0 || ph_at(h, h->free_head)->next_off != 0) {
+        printf("  ✗ FAIL: free space did not coalesce into one block\n");
+        return 0;
+    }
+    void *big = mmu_pheap_alloc(h, (size_t)h->size - PH_DATA_OFF - HDR_SZ);
+    if (!big || my_usable_size(big) < (size_t)h->size - PH_DATA_OFF - HDR_SZ) {
+        printf("  ✗ FAIL: whole heap not allocatable after frees\n");
+        return 0;
+    }
+    mmu_pheap_free(h, big);
+    if (ph_check(h, (size_t)h->size, 1) != 0) { printf("  ✗ FAIL: heap inconsistent\n"); return 0; }
+    if (!build_list(h, 1000)) { printf("  ✗ FAIL: rebuild failed\n"); return 0; }
+    mmu_pheap_close(h);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_unclean_shutdown(void) {
+    printf("TEST 3: Unclean shutdown is checked on reopen\n");
+    pid_t pid = fork();
+    if (pid == 0) {
+        MmuPHeap *h = mmu_pheap_open(path, 0, NULL);
+        if (!h) _exit(1);
+        Node *extra = mmu_pheap_alloc(h, sizeof(Node));
+        extra->next = mmu_pheap_root(h);
+        extra->value = 12345;
+        _exit(0);                           /* no close: clean flag stays 0 */
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) { printf("  ✗ FAIL: child failed\n"); return 0; }
+
+    long bad = mmu_pheap_check(path, 1);
+    MmuPHeap *h = mmu_pheap_open(path, 0, NULL);
+    if (bad != 0 || !h || !check_list(h, 1000)) {
+        printf("  ✗ FAIL: consistent heap refused after unclean shutdown (%ld problems)\n", bad);
+        return 0;
+    }
+    mmu_pheap_close(h);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_checker_detects_corruption(void) {
+    printf("TEST 4: Offline checker detects corruption\n");
+    MmuPHeap *h = mmu_pheap_open(path, 0, NULL);
+    Node *first = mmu_pheap_root(h);
+    off_t victim = (off_t)((uint8_t*)first - (uint8_t*)h) - (off_t)HDR_SZ + (off_t)offsetof(PBlock, head);
+    /* Leave the heap marked unclean, then scribble over a block header */
+    munmap(h, (size_t)h->size);
+    int fd = open(path, O_RDWR);
+    uint64_t garbage = 0xdeadbeefull;
+    if (pwrite(fd, &garbage, sizeof(garbage), victim) != (ssize_t)sizeof(garbage)) { close(fd); return 0; }
+    close(fd);
+
+    long bad = mmu_pheap_check(path, 0);
+    printf("  checker found %ld problem(s)\n", bad);
+    if (bad <= 0) { printf("  ✗ FAIL: corruption not detected\n"); return 0; }
+    errno = 0;
+    if (mmu_pheap_open(path, 0, NULL) != NULL || errno != EIO) {
+        printf("  ✗ FAIL: corrupted unclean heap was opened\n");
+        return 0;
+    }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_shared_fork(void) {
+    printf("TEST 5: Shared heap across processes (offsets, concurrent alloc/free)\n");
+    int fd;
+    MmuPHeap *h = mmu_shheap_create(8 << 20, &fd);
+    if (!h) { perror("  ✗ FAIL: mmu_shheap_create"); return 0; }
+    int pipefd[2];
+    if (pipe(pipefd) != 0) return 0;
+
+    enum { ROUNDS = 20000, WORKERS = 3 };
+    pid_t kids[WORKERS];
+    for (int w = 0; w < WORKERS; w++) {
+        kids[w] = fork();
+        if (kids[w] == 0) {
+            /* Attach a second mapping at a different address, as an
+             * unrelated process would, and consume parent buffers by offset */
+            close(pipefd[1]);
+            MmuPHeap *mine = mmu_shheap_attach(fd);
+            if (!mine || mine == h) _exit(1);
+            uint64_t off;
+            int bad = 0;
+            while (read(pipefd[0], &off, sizeof(off)) == (ssize_t)sizeof(off)) {
+                uint32_t *buf = mmu_pheap_ptr(mine, off);
+                if (buf[0] != (uint32_t)(off >> 4) || buf[63] != 0xabcd) bad = 1;
+                mmu_pheap_free(mine, buf);
+                void *own = mmu_pheap_alloc(mine, 96);
+                my_free(own);
+            }
+            mmu_shheap_detach(mine);
+            _exit(bad ? 2 : 0);
+        }
+    }
+    close(pipefd[0]);
+    for (int i = 0; i < ROUNDS; i++) {
+        uint32_t *buf = mmu_pheap_alloc(h, 64 * sizeof(uint32_t));
+        if (!buf) { printf("  ✗ FAIL: shared allocation %d failed\n", i); return 0; }
+        uint64_t off = mmu_pheap_off(h, buf);
+        buf[0] = (uint32_t)(off >> 4);
+        buf[63] = 0xabcd;
+        if (write(pipefd[1], &off, sizeof(off)) != (ssize_t)sizeof(off)) return 0;
+    }
+    close(pipefd[1]);
+    int ok = 1;
+    for (int w = 0; w < WORKERS; w++) {
+        int status;
+        waitpid(kids[w], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = 0;
+    }
+    if (!ok) { printf("  ✗ FAIL: a worker saw bad data\n"); return 0; }
+    if (ph_check(h, (size_t)h->size, 1) != 0 || ph_at(h, h->free_head)->next_off != 0) {
+        printf("  ✗ FAIL: shared heap inconsistent after concurrent use\n");
+        return 0;
+    }
+    printf("  ✓ %d buffers handed to %d workers by offset and freed there\n", ROUNDS, WORKERS);
+    mmu_shheap_detach(h);
+    close(fd);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_shared_owner_death(void) {
+    printf("TEST 6: Robust lock survives a worker dying mid-operation\n");
+    MmuPHeap *h = mmu_shheap_create(1 << 20, NULL);
+    void *keep = mmu_pheap_alloc(h, 1000);
+    pid_t pid = fork();
+    if (pid == 0) {
+        ph_lock(h);
+        /* Die holding the lock with the free list half-unlinked */
+        h->free_head = 0;
+        _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    void *p = mmu_pheap_alloc(h, 1000);
+    printf("  allocation after owner death: %p (recoveries: %u)\n", p, h->recoveries);
+    if (!p || h->recoveries != 1 || ph_check(h, (size_t)h->size, 1) != 0) {
+        printf("  ✗ FAIL: heap not recovered\n");
+        return 0;
+    }
+    mmu_pheap_free(h, p);
+    mmu_pheap_free(h, keep);
+    mmu_shheap_detach(h);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main(void) {
+    printf("=== PERSISTENT HEAP TEST SUITE ===\n\n");
+    int fd = mkstemp(path);
+    if (fd < 0) { perror("mkstemp"); return 1; }
+    close(fd);
+    int passed = 0, total = 6;
+    passed += test_reopen();
+    passed += test_free_and_coalesce();
+    passed += test_unclean_shutdown();
+    passed += test_checker_detects_corruption();
+    passed += test_shared_fork();
+    passed += test_shared_owner_death();
+    unlink(path);
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Object pool (mmu_pool_*) test suite */
+
+typedef struct {
+    uint64_t id;
+    char payload[40];
+} Node48;
+
+static int test_basic(void) {
+    printf("TEST 1: Basic pool alloc/free\n");
+    MmuPool *pool = mmu_pool_create(sizeof(Node48), 0);
+    if (!pool) { printf("  ✗ FAIL: mmu_pool_create returned NULL\n"); return 0; }
+
+    Node48 *a = mmu_pool_alloc(pool);
+    Node48 *b = mmu_pool_alloc(pool);
+    if (!a || !b || a == b) { printf("  ✗ FAIL: bad allocations %p %p\n", (void*)a, (void*)b); return 0; }
+    a->id = 1; b->id = 2;
+    mmu_pool_free(pool, a);
+    Node48 *c = mmu_pool_alloc(pool);
+    printf("  a=%p b=%p c=%p (c should reuse a)\n", (void*)a, (void*)b, (void*)c);
+    if (c != a || b->id != 2) { printf("  ✗ FAIL: freed object not reused\n"); return 0; }
+    mmu_pool_free(pool, b);
+    mmu_pool_free(pool, c);
+    mmu_pool_destroy(pool);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_alignment_and_density(void) {
+    printf("TEST 2: Alignment and zero per-object headers\n");
+    size_t aligns[] = {8, 16, 64, 256};
+    for (int i = 0; i < 4; i++) {
+        MmuPool *pool = mmu_pool_create(48, aligns[i]);
+        size_t stride = ALIGN_UP(48, aligns[i]);
+        uint8_t *prev = NULL;
+        for (int k = 0; k < 100; k++) {
+            uint8_t *p = mmu_pool_alloc(pool);
+            if ((uintptr_t)p % aligns[i]) {
+                printf("  ✗ FAIL: %p not aligned to %zu\n", (void*)p, aligns[i]);
+                return 0;
+            }
+            if (prev && p - prev != (ptrdiff_t)stride) {
+                printf("  ✗ FAIL: stride %td, expected %zu\n", p - prev, stride);
+                return 0;
+            }
+            prev = p;
+        }
+        printf("  ✓ align %3zu: stride %zu bytes\n", aligns[i], stride);
+        mmu_pool_destroy(pool);
+    }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_many_slabs(void) {
+    printf("TEST 3: Many slabs, interleaved free, slab return\n");
+    const int n = 50000;
+    MmuPool *pool = mmu_pool_create(64, 0);
+    uint64_t **objs = malloc(n * sizeof(*objs));
+    for (int i = 0; i < n; i++) {
+        objs[i] = mmu_pool_alloc(pool);
+        if (!objs[i]) { printf("  ✗ FAIL: allocation %d failed\n", i); return 0; }
+        *objs[i] = (uint64_t)i;
+    }
+    for (int i = 0; i < n; i += 2) mmu_pool_free(pool, objs[i]);
+    for (int i = 1; i < n; i += 2) {
+        if (*objs[i] != (uint64_t)i) { printf("  ✗ FAIL: object %d corrupted\n", i); return 0; }
+    }
+    for (int i = 0; i < n; i += 2) objs[i] = mmu_pool_alloc(pool);
+    for (int i = 0; i < n; i++) mmu_pool_free(pool, objs[i]);
+    if (pool->partial || pool->full) {
+        printf("  ✗ FAIL: slabs still held after freeing everything\n");
+        return 0;
+    }
+    printf("  ✓ All slabs returned (one spare kept: %s)\n", pool->spare ? "yes" : "no");
+    free(objs);
+    mmu_pool_destroy(pool);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_cache_colouring(void) {
+    printf("TEST 4: Cache colouring across slabs\n");
+    MmuPool *pool = mmu_pool_create(1000, 8);
+    int per_slab = (POOL_SLAB_SIZE - 64) / 1000;
+    uintptr_t first_off[3];
+    void **objs = malloc(3 * per_slab * sizeof(void*));
+    for (int i = 0; i < 3 * per_slab; i++) objs[i] = mmu_pool_alloc(pool);
+    int slab = 0;
+    for (int i = 0; i < 3 * per_slab && slab < 3; i++) {
+        if (i == 0 || pool_slab_of(objs[i]) != pool_slab_of(objs[i-1]))
+            first_off[slab++] = (uintptr_t)objs[i] & (POOL_SLAB_SIZE - 1);
+    }
+    printf("  first object offsets: %lu %lu %lu\n",
+           (unsigned long)first_off[0], (unsigned long)first_off[1], (unsigned long)first_off[2]);
+    if (first_off[0] == first_off[1] || first_off[1] == first_off[2]) {
+        printf("  ✗ FAIL: slabs are not coloured\n");
+        return 0;
+    }
+    for (int i = 0; i < 3 * per_slab; i++) mmu_pool_free(pool, objs[i]);
+    free(objs);
+    mmu_pool_destroy(pool);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_unified_free(void) {
+    printf("TEST 5: my_free and my_usable_size find the owning pool\n");
+    MmuPool *pool = mmu_pool_create(48, 0);
+    void *objs[2000];
+    for (int i = 0; i < 2000; i++) objs[i] = mmu_pool_alloc(pool);
+    if (my_usable_size(objs[0]) != 48) {
+        printf("  ✗ FAIL: usable size %zu, expected 48\n", my_usable_size(objs[0]));
+        return 0;
+    }
+    for (int i = 0; i < 2000; i++) my_free(objs[i]);
+    if (pool->partial || pool->full) { printf("  ✗ FAIL: my_free did not return objects to the pool\n"); return 0; }
+    mmu_pool_destroy(pool);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main(void) {
+    printf("=== OBJECT POOL TEST SUITE ===\n\n");
+    int passed = 0, total = 5;
+    passed += test_basic();
+    passed += test_alignment_and_density();
+    passed += test_many_slabs();
+    passed += test_cache_colouring();
+    passed += test_unified_free();
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}
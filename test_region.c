@@ -0,0 +1,109 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Region allocator (mmu_region_*) test suite */
+
+static int count_chunks(MmuRegion *r) {
+    int n = 0;
+    for (RegionChunk *c = r->chunks; c; c = c->next) n++;
+    return n;
+}
+
+static int test_bump(void) {
+    printf("TEST 1: Bump allocation and alignment\n");
+    MmuRegion *r = mmu_region_create(0, 0);
+    uint8_t *prev = NULL;
+    for (size_t s = 1; s <= 64; s++) {
+        uint8_t *p = mmu_region_alloc(r, s);
+        if (!p || (uintptr_t)p % ALIGN) {
+            printf("  ✗ FAIL: %zu bytes -> %p\n", s, (void*)p);
+            return 0;
+        }
+        if (prev && p <= prev) { printf("  ✗ FAIL: bump pointer went backwards\n"); return 0; }
+        memset(p, (int)s, s);
+        prev = p;
+    }
+    if (count_chunks(r) != 1) { printf("  ✗ FAIL: expected a single chunk\n"); return 0; }
+    uint8_t *first = (uint8_t*)r->chunks + REGION_HDR_SZ;
+    if (REGION_HDR_SZ >= ARENA_HDR_SZ || *first != 1) {
+        printf("  ✗ FAIL: chunk header is %zu bytes, first object not right after it\n", (size_t)REGION_HDR_SZ);
+        return 0;
+    }
+    mmu_region_destroy(r);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_growth_and_large(void) {
+    printf("TEST 2: Chunk growth and oversized allocations\n");
+    MmuRegion *r = mmu_region_create(64 << 10, 0);
+    for (int i = 0; i < 1000; i++) {
+        void *p = mmu_region_alloc(r, 1000);
+        if (!p) { printf("  ✗ FAIL: allocation %d failed\n", i); return 0; }
+        memset(p, 0x5a, 1000);
+    }
+    void *big = mmu_region_alloc(r, 1 << 20);
+    if (!big) { printf("  ✗ FAIL: 1MB allocation failed\n"); return 0; }
+    memset(big, 0xa5, 1 << 20);
+    printf("  Chunks after 1000x1KB + 1MB: %d\n", count_chunks(r));
+    mmu_region_destroy(r);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_reset_warm(void) {
+    printf("TEST 3: Reset keeps one warm chunk\n");
+    MmuRegion *r = mmu_region_create(64 << 10, 1);
+    uint8_t *warm_start = NULL;
+    for (int round = 0; round < 5; round++) {
+        for (int i = 0; i < 300; i++) {
+            void *p = mmu_region_alloc(r, 512);
+            if (!p) { printf("  ✗ FAIL: allocation failed\n"); return 0; }
+            if (i == 0 && warm_start && p != warm_start) {
+                printf("  ✗ FAIL: warm chunk not reused after reset\n");
+                return 0;
+            }
+        }
+        mmu_region_reset(r);
+        if (count_chunks(r) != 1) { printf("  ✗ FAIL: %d chunks after reset\n", count_chunks(r)); return 0; }
+        warm_start = r->chunks->bump;
+    }
+    printf("  ✓ One chunk retained across resets\n");
+
+    MmuRegion *cold = mmu_region_create(64 << 10, 0);
+    mmu_region_alloc(cold, 100);
+    mmu_region_reset(cold);
+    if (count_chunks(cold) != 0) { printf("  ✗ FAIL: cold region kept chunks\n"); return 0; }
+    mmu_region_destroy(cold);
+    mmu_region_destroy(r);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int test_independent_of_heap(void) {
+    printf("TEST 4: Regions do not touch the general heap index\n");
+    allocator_init(STRAT_BEST);
+    void *a = malloc_best_fit(100);
+    Block *root_before = g_avl_root;
+    MmuRegion *r = mmu_region_create(0, 1);
+    for (int i = 0; i < 10000; i++) mmu_region_alloc(r, 48);
+    mmu_region_reset(r);
+    if (g_avl_root != root_before) { printf("  ✗ FAIL: free index changed\n"); return 0; }
+    mmu_region_destroy(r);
+    my_free(a);
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main(void) {
+    printf("=== REGION ALLOCATOR TEST SUITE ===\n\n");
+    int passed = 0, total = 4;
+    passed += test_bump();
+    passed += test_growth_and_large();
+    passed += test_reset_warm();
+    passed += test_independent_of_heap();
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}
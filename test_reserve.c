@@ -0,0 +1,196 @@
+#include "2022MT11172mmu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/* Address-space reservation (mmu_reserve) test suite.
+ * A reservation is once per process, so each case runs in a forked child. */
+
+static int in_child(int (*fn)(void)) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) _exit(fn() ? 0 : 1);
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static long minor_faults(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_minflt;
+}
+
+/* Arenas in address order must tile [base, top) with no gaps. */
+static int arenas_contiguous(void) {
+    uint8_t *expect = g_rsv_base;
+    for (;;) {
+        Arena *next = NULL;
+        for (Arena *ar = g_arenas; ar; ar = ar->next)
+            if ((uint8_t*)ar == expect) next = ar;
+        if (!next) return expect == g_rsv_top;
+        expect += next->size;
+    }
+}
+
+static int contiguous_child(void) {
+    if (!mmu_reserve(64u << 20, 0)) return 0;
+    if (!rsv_contains(g_arenas) || g_arenas->next) { printf("  initial arena not moved\n"); return 0; }
+    allocator_init(STRAT_BEST);
+    static void *ptrs[6000];
+    for (int i = 0; i < 6000; i++) {
+        ptrs[i] = malloc_best_fit(1000 + (size_t)(i % 7) * 1000);
+        memset(ptrs[i], i, 64);
+        if (!rsv_contains(ptrs[i])) { printf("  block %d outside the reservation\n", i); return 0; }
+    }
+    int arenas = 0;
+    for (Arena *ar = g_arenas; ar; ar = ar->next) arenas++;
+    if (arenas < 3 || !arenas_contiguous()) { printf("  %d arenas, not contiguous\n", arenas); return 0; }
+    for (int i = 0; i < 6000; i++) {
+        if (*(uint8_t*)ptrs[i] != (uint8_t)i) return 0;
+        if (i % 2) my_free_sized(ptrs[i], 1000 + (size_t)(i % 7) * 1000);
+        else my_free(ptrs[i]);
+    }
+    return g_free_blocks == (size_t)arenas;
+}
+
+static int test_contiguous(void) {
+    printf("TEST 1: Arenas are committed back to back inside the reservation\n");
+    if (!in_child(contiguous_child)) { printf("  ✗ FAIL: heap not laid out in the reservation\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int exhaust_child(void) {
+    if (!mmu_reserve(2u << 20, 0) || mmu_reserve(2u << 20, 0)) return 0;   /* second call refused */
+    allocator_init(STRAT_FIRST);
+    void *in = malloc_first_fit(512 << 10);
+    void *out = malloc_first_fit(3u << 20);          /* does not fit what is left */
+    if (!in || !out || !rsv_contains(in) || rsv_contains(out)) return 0;
+    if (pm_kind(pagemap_get(out)) != OWN_ARENA) return 0;
+    memset(out, 1, 3u << 20);
+    my_free(out);
+    my_free(in);
+    return 1;
+}
+
+static int test_exhaust(void) {
+    printf("TEST 2: A full reservation falls back to mmap; a second reserve is refused\n");
+    if (!in_child(exhaust_child)) { printf("  ✗ FAIL: overflow arena mishandled\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int release_child(void) {
+    if (!mmu_reserve(64u << 20, 0)) return 0;
+    allocator_init(STRAT_BEST);
+    void *small = malloc_best_fit(100);
+    uint8_t *top = g_rsv_top;
+    void *big = malloc_best_fit(8u << 20);           /* new arena at the top */
+    if (g_rsv_top <= top) return 0;
+    my_free(big);
+    mmu_compact(0);                                  /* unmaps the now empty arena */
+    if (g_rsv_top != top) { printf("  top not handed back\n"); return 0; }
+    void *again = malloc_best_fit(8u << 20);
+    if (again != big) { printf("  %p reused as %p\n", big, again); return 0; }
+    memset(again, 2, 8u << 20);
+    my_free(again);
+    my_free(small);
+    return 1;
+}
+
+static int test_release(void) {
+    printf("TEST 3: Compaction returns the topmost arena to the reservation\n");
+    if (!in_child(release_child)) { printf("  ✗ FAIL: released arena not reused\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+static int hole_child(void) {
+    if (!mmu_reserve(64u << 20, 0)) return 0;
+    allocator_init(STRAT_BEST);
+    void *small = malloc_best_fit(100);
+    void *mid = malloc_best_fit(8u << 20);           /* arena below the top */
+    void *top = malloc_best_fit(8u << 20);
+    uint8_t *rsv_top = g_rsv_top;
+    my_free(mid);
+    mmu_compact(0);                                  /* releases mid's arena, leaving a hole */
+    if (g_rsv_nholes != 1 || g_rsv_top != rsv_top) { printf("  %u holes\n", g_rsv_nholes); return 0; }
+    if (pm_kind(owner_of(mid)) == OWN_ARENA) { printf("  hole still reported as arena memory\n"); return 0; }
+    if (pm_kind(owner_of(small)) != OWN_ARENA) return 0;
+    void *again = malloc_best_fit(8u << 20);
+    if (again != mid || g_rsv_nholes || g_rsv_top != rsv_top) {
+        printf("  hole at %p not reused (got %p)\n", mid, again);
+        return 0;
+    }
+    memset(again, 3, 8u << 20);
+    my_free(again);
+    my_free(top);
+    my_free(small);
+    mmu_compact(0);                                  /* top arena, then the hole below it */
+    return g_rsv_nholes == 0 && mmu_check_heap(1) == 0;
+}
+
+static int test_hole(void) {
+    printf("TEST 5: An arena released below the top is reused and no longer counts as heap\n");
+    if (!in_child(hole_child)) { printf("  ✗ FAIL: hole in the reservation mishandled\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+/* Faults taken while the heap grows to 24MB and every page is written. */
+static long growth_faults(void) {
+    allocator_init(STRAT_FIRST);
+    long before = minor_faults();
+    for (int i = 0; i < 24 * 16; i++) {
+        uint8_t *p = malloc_first_fit(64u << 10);
+        if (!p) return -1;
+        for (size_t off = 0; off < (64u << 10); off += 4096) p[off] = 1;
+    }
+    return minor_faults() - before;
+}
+
+static int fault_pipe[2];
+
+static int prefault_child(void) {
+    if (!mmu_reserve(32u << 20, 1)) return 0;
+    long n = growth_faults();
+    return write(fault_pipe[1], &n, sizeof(n)) == sizeof(n);
+}
+
+static int lazy_child(void) {
+    long n = growth_faults();
+    return write(fault_pipe[1], &n, sizeof(n)) == sizeof(n);
+}
+
+static int test_prefault(void) {
+    printf("TEST 4: A prefaulted reservation grows the heap without page faults\n");
+    long lazy = -1, pre = -1;
+    if (pipe(fault_pipe) != 0) return 0;
+    if (!in_child(lazy_child) || read(fault_pipe[0], &lazy, sizeof(lazy)) != sizeof(lazy) ||
+        !in_child(prefault_child) || read(fault_pipe[0], &pre, sizeof(pre)) != sizeof(pre)) {
+        printf("  ✗ FAIL: child failed\n");
+        return 0;
+    }
+    close(fault_pipe[0]);
+    close(fault_pipe[1]);
+    printf("  minor faults writing 24MB: %ld on demand, %ld prefaulted\n", lazy, pre);
+    if (lazy < 24 * 256 / 2 || pre > lazy / 4) { printf("  ✗ FAIL: prefault did not take the faults up front\n"); return 0; }
+    printf("  ✓ PASS\n\n");
+    return 1;
+}
+
+int main(void) {
+    printf("=== RESERVATION TEST SUITE ===\n\n");
+    int passed = 0, total = 5;
+    passed += test_contiguous();
+    passed += test_exhaust();
+    passed += test_release();
+    passed += test_prefault();
+    passed += test_hole();
+    printf("Results: %d/%d tests passed\n", passed, total);
+    return passed == total ? 0 : 1;
+}